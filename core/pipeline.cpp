@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "pipeline.h"
+
+namespace videograph {
+
+template <typename real>
+Pipeline<real>::Pipeline(const PipelineOptions &options)
+  : options_(options), submitted_(0),
+    input_(options.queue), built_(options.queue), segmented_(options.queue) {
+  builder_ = std::thread(&Pipeline<real>::buildstage, this);
+  segmenter_ = std::thread(&Pipeline<real>::segmentstage, this);
+  postprocessor_ = std::thread(&Pipeline<real>::poststage, this);
+}
+
+template <typename real>
+Pipeline<real>::~Pipeline() {
+  close();
+  builder_.join();
+  segmenter_.join();
+  postprocessor_.join();
+}
+
+template <typename real>
+void Pipeline<real>::close() {
+  input_.close();
+}
+
+template <typename real>
+template <typename T>
+std::future<Result<real> > Pipeline<real>::submit(const T *frames, const Video &v, Callback callback) {
+  Job job;
+  job.result.status = OK;
+  job.result.vol.length = v.length;
+  job.result.vol.height = v.height;
+  job.result.vol.width = v.width;
+  job.result.ncomps = 0;
+  job.nmaps = stencilplanes(options_.connex);
+  job.callback = callback;
+  Video geometry = v;
+  int connex = options_.connex;
+  char dt = options_.dt;
+  job.build = [frames, geometry, connex, dt](real *dst) {
+    return graph(dst, frames, geometry, connex, dt);
+  };
+  std::future<Result<real> > future = job.promise.get_future();
+
+  // number chunks in the order they enter the pipeline
+  std::lock_guard<std::mutex> lock(submit_mutex_);
+  job.result.index = submitted_++;
+  if (!input_.push(job)) {
+    job.result.status = ERROR_ARG;   // pipeline closed
+    finish(job);
+  }
+  return future;
+}
+
+template <typename real>
+void Pipeline<real>::finish(Job &job) {
+  if (job.callback) job.callback(job.result);
+  job.promise.set_value(std::move(job.result));
+}
+
+// stage 1: graph construction
+template <typename real>
+void Pipeline<real>::buildstage() {
+  Job job;
+  while (input_.pop(job)) {
+    const Volume &vol = job.result.vol;
+    if (job.nmaps < 0) {
+      job.result.status = job.nmaps;
+    } else if (vol.length <= 0 || vol.height <= 0 || vol.width <= 0) {
+      job.result.status = ERROR_DIMS;
+    } else {
+      try {
+        job.graph.resize(vol.length*job.nmaps*vol.height*vol.width);
+        job.result.status = job.build(&job.graph[0]);
+      } catch (const std::bad_alloc &) {
+        job.result.status = ERROR_MEMORY;
+      }
+    }
+    job.build = std::function<int(real *)>();   // input no longer referenced
+    built_.push(job);
+  }
+  built_.close();
+}
+
+// stage 2: segmentation
+template <typename real>
+void Pipeline<real>::segmentstage() {
+  Job job;
+  while (built_.pop(job)) {
+    const Volume &vol = job.result.vol;
+    if (job.result.status == OK) {
+      try {
+        job.result.labels.resize(vol.length*vol.height*vol.width);
+      } catch (const std::bad_alloc &) {
+        job.result.status = ERROR_MEMORY;
+      }
+    }
+    if (job.result.status == OK) {
+      long n = segmentmst(&job.result.labels[0], (const real *)&job.graph[0], vol, job.nmaps,
+                          (real)options_.thres, options_.minsize, options_.adaptive);
+      if (n < 0) job.result.status = n;
+      else job.result.ncomps = n;
+    }
+    std::vector<real>().swap(job.graph);
+    segmented_.push(job);
+  }
+  segmented_.close();
+}
+
+// stage 3: post-processing, and delivery
+template <typename real>
+void Pipeline<real>::poststage() {
+  Job job;
+  while (segmented_.pop(job)) {
+    Result<real> &result = job.result;
+    if (result.status == OK && options_.stats) {
+      real *stats = NULL;
+      long n = componentstats((const real *)&result.labels[0], result.vol, &stats);
+      if (n < 0) {
+        result.status = n;
+      } else {
+        try {
+          result.stats.assign(stats, stats + n*STATS_SIZE);
+        } catch (const std::bad_alloc &) {
+          result.status = ERROR_MEMORY;
+        }
+      }
+      free(stats);
+    }
+    if (result.status == OK && options_.adjacency) {
+      long *pairs = NULL;
+      long n = adjacency((const real *)&result.labels[0], result.vol, &pairs);
+      if (n < 0) {
+        result.status = n;
+      } else {
+        try {
+          result.pairs.assign(pairs, pairs + 2*n);
+        } catch (const std::bad_alloc &) {
+          result.status = ERROR_MEMORY;
+        }
+      }
+      free(pairs);
+    }
+    finish(job);
+  }
+}
+
+template class Pipeline<float>;
+template class Pipeline<double>;
+
+#define VIDEOGRAPH_INSTANTIATE_SUBMIT(real, T)                          \
+  template std::future<Result<real> > Pipeline<real>::submit<T>(const T *, const Video &, \
+                                                               Pipeline<real>::Callback);
+
+VIDEOGRAPH_INSTANTIATE_SUBMIT(float, float)
+VIDEOGRAPH_INSTANTIATE_SUBMIT(float, unsigned char)
+VIDEOGRAPH_INSTANTIATE_SUBMIT(double, double)
+VIDEOGRAPH_INSTANTIATE_SUBMIT(double, unsigned char)
+
+}
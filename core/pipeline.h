@@ -0,0 +1,149 @@
+#ifndef _VIDEOGRAPH_PIPELINE_
+#define _VIDEOGRAPH_PIPELINE_
+
+/*
+  videograph pipeline: asynchronous, stage-parallel processing of a
+  stream of frame chunks.
+
+  Each chunk goes through 3 stages, each run by its own thread:
+    1. graph construction        (graph)
+    2. segmentation              (segmentmst)
+    3. post-processing           (componentstats, adjacency)
+  so that chunk n+1's graph is built while chunk n is segmented and
+  chunk n-1 is post-processed. Stages are connected by bounded queues:
+  submit() blocks when the pipeline is full, which bounds the chunks
+  being processed, not the results. A result is held by its future
+  until the caller collects it: a caller that keeps submitting must
+  collect results as it goes, or they pile up. Allocation failures
+  in the stages are reported as ERROR_MEMORY in the result.
+
+  Results are delivered through a future, and optionally a callback,
+  invoked from the post-processing thread. Chunks complete in
+  submission order. The frames passed to submit() are read in place:
+  they must stay valid until the chunk's graph is built (at the
+  latest, until its result is ready).
+*/
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+
+#include "videograph.h"
+
+namespace videograph {
+
+// result of one chunk
+template <typename real>
+struct Result {
+  long index;                  // submission order (0-based)
+  int status;                  // OK, or a negative status code
+  Volume vol;                  // dims of labels
+  std::vector<real> labels;    // LxHxW component ids (root voxel index)
+  long ncomps;                 // number of components
+  std::vector<real> stats;     // ncomps records of STATS_SIZE (if enabled)
+  std::vector<long> pairs;     // adjacent pairs (a,b), a < b (if enabled)
+};
+
+// pipeline parameters
+struct PipelineOptions {
+  int connex;                  // 6 | CONNEX_6T2 | 8 | 18 | 26 (see stencil.h)
+  char dt;                     // distance: 'e' | 'a' | 'm'
+  double thres;                // segmentmst threshold
+  int minsize;                 // segmentmst min component size
+  bool adaptive;               // segmentmst adaptive threshold
+  bool stats;                  // compute component stats
+  bool adjacency;              // compute adjacency pairs
+  size_t queue;                // capacity of each inter-stage queue
+
+  PipelineOptions()
+    : connex(6), dt('e'), thres(3), minsize(20), adaptive(true),
+      stats(true), adjacency(true), queue(2) {}
+};
+
+// blocking, bounded FIFO; pop() returns false once closed and empty
+template <typename Item>
+class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1), closed_(false) {}
+
+  bool push(Item &item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notfull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) return false;
+    items_.push_back(std::move(item));
+    notempty_.notify_one();
+    return true;
+  }
+
+  bool pop(Item &item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notempty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) return false;
+    item = std::move(items_.front());
+    items_.pop_front();
+    notfull_.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    notempty_.notify_all();
+    notfull_.notify_all();
+  }
+
+private:
+  size_t capacity_;
+  bool closed_;
+  std::deque<Item> items_;
+  std::mutex mutex_;
+  std::condition_variable notfull_, notempty_;
+};
+
+template <typename real>
+class Pipeline {
+public:
+  typedef std::function<void(const Result<real> &)> Callback;
+
+  explicit Pipeline(const PipelineOptions &options);
+  ~Pipeline();   // finishes all submitted chunks, then joins
+
+  // submits a chunk of frames (LxKxHxW, any strides, see Video);
+  // blocks while the pipeline is full (results are not counted: see
+  // above)
+  template <typename T>
+  std::future<Result<real> > submit(const T *frames, const Video &v,
+                                    Callback callback = Callback());
+
+  // stops accepting chunks; pending chunks are still processed
+  void close();
+
+private:
+  struct Job {
+    Result<real> result;
+    std::function<int(real *)> build;   // stage 1 kernel, bound to the input
+    long nmaps;
+    std::vector<real> graph;
+    std::promise<Result<real> > promise;
+    Callback callback;
+  };
+
+  void buildstage();
+  void segmentstage();
+  void poststage();
+  void finish(Job &job);
+
+  PipelineOptions options_;
+  long submitted_;
+  std::mutex submit_mutex_;
+  BoundedQueue<Job> input_, built_, segmented_;
+  std::thread builder_, segmenter_, postprocessor_;
+};
+
+}
+
+#endif
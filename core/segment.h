@@ -0,0 +1,217 @@
+#ifndef _VIDEOGRAPH_SEGMENT_
+#define _VIDEOGRAPH_SEGMENT_
+
+/*
+  Segmentation internals, shared by segmentmst (whole volumes) and
+  Stream (videos segmented as their frames arrive): edge lists, the merging
+  passes over a disjoint-set forest, and label outputs (dense, or
+  runs). Include after videograph.h, set.h and stencil.h.
+*/
+
+namespace videograph {
+
+typedef struct {
+  float w;
+  int a, b;
+} Edge;
+
+static void sort_edges(Edge *data, int N)
+{
+  int i, j;
+  float v;
+  Edge t;
+
+  if(N<=1) return;
+
+  // Partition elements
+  v = data[0].w;
+  i = 0;
+  j = N;
+  for(;;)
+    {
+      while(data[++i].w < v && i < N) { }
+      while(data[--j].w > v) { }
+      if(i >= j) break;
+      t = data[i]; data[i] = data[j]; data[j] = t;
+    }
+  t = data[i-1]; data[i-1] = data[0]; data[0] = t;
+  sort_edges(data, i-1);
+  sort_edges(data+i, N-i);
+}
+
+// appends the edge of plane k, between voxels i and j, if j >= jmin
+// (only checked if CHECK); voxel indices are offset by base
+template <class S, typename real, bool CHECK>
+struct ExtractEdge {
+  Edge *edges;
+  int *nedges;
+  const real *src;
+  long height, width;
+  long jmin, base;
+  inline void operator()(int k, long x, long y, long z, long i, long j) {
+    if (CHECK && j < jmin) return;
+    Edge *e = edges + (*nedges)++;
+    e->a = base + i;
+    e->b = base + j;
+    e->w = src[((z*S::size+k)*height+y)*width+x];
+  }
+};
+
+// extracts the edges of a graph (LxPxHxW) that end in frames
+// [overlap,length) (see appendgraph)
+template <typename real>
+struct ExtractEdges {
+  Edge *edges;
+  int *nedges;
+  const real *src;
+  long length, height, width;
+  long overlap, base;
+  template <class S> int operator()(S) {
+    // as in appendgraph: only the edges starting before frame overlap
+    // are checked
+    long z0 = overlap - Margins<S>().zhi;
+    if (z0 < 0) z0 = 0;
+    long jmin = overlap*height*width;
+    ExtractEdge<S, real, true> border = {edges, nedges, src, height, width, jmin, base};
+    forEachEdge<S>(length, height, width, z0, overlap, border);
+    ExtractEdge<S, real, false> extract = {edges, nedges, src, height, width, jmin, base};
+    forEachEdge<S>(length, height, width, overlap, length, extract);
+    return OK;
+  }
+};
+
+// sorted edges, either extracted (Edge records), or read from a graph
+// file (endpoint arrays, and weights as floats or quantized codes)
+struct EdgeList {
+  const Edge *edges;
+  inline float w(long i) const { return edges[i].w; }
+  inline int a(long i) const { return edges[i].a; }
+  inline int b(long i) const { return edges[i].b; }
+  int status() const { return OK; }
+};
+
+// for each edge in [first,last), in non-decreasing weight order,
+// decide to merge or not, depending on current threshold
+template <typename real, class Edges>
+static void mergeedges(Set *set, real *threshold, const Edges &edges, long first, long last,
+                       real thres, bool adaptivethres) {
+  long i;
+  for (i = first; i < last; i++) {
+    // components conected by this edge
+    float w = edges.w(i);
+    int a = set_find(set, edges.a(i));
+    int b = set_find(set, edges.b(i));
+    if (a != b) {
+      if ((w <= threshold[a]) && (w <= threshold[b])) {
+        set_join(set, a, b);
+        a = set_find(set, a);
+        if (adaptivethres) {
+          threshold[a] = w + thres/set->elts[a].surface;
+        }
+      }
+    }
+  }
+}
+
+// post process small components, along edges [first,last)
+template <class Edges>
+static void mergesmall(Set *set, const Edges &edges, long first, long last, int minsize) {
+  long i;
+  for (i = first; i < last; i++) {
+    int a = set_find(set, edges.a(i));
+    int b = set_find(set, edges.b(i));
+    if ((a != b) && ((set->elts[a].surface < minsize) || (set->elts[b].surface < minsize)))
+      set_join(set, a, b);
+  }
+}
+
+// label outputs, written in raster order: a dense volume, or runs
+// (see Runs)
+template <typename real>
+struct DenseWriter {
+  real *labels;
+  int begin() { return OK; }
+  inline void put(long, int id) { *labels++ = id; }
+  inline void endrow() {}
+  inline int finish() { return OK; }
+};
+
+struct RunWriter {
+  Runs *out;
+  long capacity;
+  long row;
+  int status;
+
+  RunWriter(Runs *runs, const Volume &vol) : out(runs), capacity(0), row(0), status(OK) {
+    out->vol = vol;
+    out->nruns = 0;
+    out->rows = NULL;
+    out->runs = NULL;
+  }
+  int begin() {
+    out->rows = (long *)malloc((out->vol.length*out->vol.height+1)*sizeof(long));
+    if (!out->rows) return ERROR_MEMORY;
+    out->rows[0] = 0;
+    return OK;
+  }
+  inline void put(long x, int id) {
+    if (status < 0) return;
+    // extend the current run, or start a new one
+    long n = out->nruns;
+    if (x > 0 && out->runs[2*n-1] == id) {
+      out->runs[2*n-2] = x+1;
+      return;
+    }
+    if (n == capacity) {
+      capacity = capacity ? 2*capacity : 1024;
+      int32_t *runs = (int32_t *)realloc(out->runs, 2*capacity*sizeof(int32_t));
+      if (!runs) { status = ERROR_MEMORY; return; }
+      out->runs = runs;
+    }
+    out->runs[2*n] = x+1;
+    out->runs[2*n+1] = id;
+    out->nruns++;
+  }
+  inline void endrow() {
+    if (status == OK) out->rows[++row] = out->nruns;
+  }
+  int finish() {
+    if (status < 0) {
+      free(out->rows); free(out->runs);
+      out->rows = NULL; out->runs = NULL; out->nruns = 0;
+      return status;
+    }
+    // give back the unused capacity (if that fails, keep it)
+    if (out->nruns > 0 && out->nruns < capacity) {
+      int32_t *runs = (int32_t *)realloc(out->runs, 2*out->nruns*sizeof(int32_t));
+      if (runs) out->runs = runs;
+    }
+    return OK;
+  }
+};
+
+// writes the component of each voxel of vol, whose first voxel is
+// element base of the forest: its root or, if nextid is given, the id
+// of its root (ids are handed out in order of first output)
+template <class Writer>
+static void writelabels(Writer &labels, Set *set, const Volume &vol, long base, int *nextid) {
+  long x,y,z;
+  for (z = 0; z < vol.length; z++) {
+    for (y = 0; y < vol.height; y++) {
+      for (x = 0; x < vol.width; x++) {
+        int root = set_find(set, base + (z * vol.height + y) * vol.width + x);
+        if (!nextid) {
+          labels.put(x, root);
+        } else {
+          if (set->elts[root].id < 0) set->elts[root].id = (*nextid)++;
+          labels.put(x, set->elts[root].id);
+        }
+      }
+      labels.endrow();
+    }
+  }
+}
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef _SET_
+#define _SET_
+
+/*
+  This file provides a very simple data structure to represent
+  a disjoint set. This code is heavily inspired by Pedro
+  Felzenszwalb's min-spanning tree code, released under a 
+  GNU GPL license (Copyright (C) 2006 Pedro).
+*/
+
+typedef struct {
+  int pseudorank;
+  int parent;
+  int surface;
+  int id;
+} Elt;
+
+typedef struct {
+  Elt *elts;
+  int nelts;    // number of components
+  int size;     // number of elements
+  int capacity; // number of allocated elements
+} Set;
+
+// returns NULL if out of memory
+static Set * set_new(int nelts) {
+  Set *set = (Set *)calloc(1, sizeof(Set));
+  if (!set) return NULL;
+  set->elts = (Elt *)calloc(nelts, sizeof(Elt));
+  if (!set->elts) {
+    free(set);
+    return NULL;
+  }
+  set->nelts = nelts;
+  set->size = nelts;
+  set->capacity = nelts;
+  int i;
+  for (i = 0; i < nelts; i++) {
+    set->elts[i].pseudorank = 0;
+    set->elts[i].surface = 1;
+    set->elts[i].parent = i;
+    set->elts[i].id = -1;
+  }
+  return set;
+}
+
+// appends n singleton elements (storage grows geometrically); returns
+// 0, or -1 if out of memory (the set is then unchanged)
+static inline int set_grow(Set *set, int n) {
+  if (set->size + n > set->capacity) {
+    long capacity = 2L*set->capacity;
+    if (capacity < set->size + n) capacity = set->size + n;
+    if (capacity > 0x7fffffff) capacity = 0x7fffffff;
+    Elt *elts = (Elt *)realloc(set->elts, capacity*sizeof(Elt));
+    if (!elts) return -1;
+    set->elts = elts;
+    set->capacity = capacity;
+  }
+  int i;
+  for (i = set->size; i < set->size + n; i++) {
+    set->elts[i].pseudorank = 0;
+    set->elts[i].surface = 1;
+    set->elts[i].parent = i;
+    set->elts[i].id = -1;
+  }
+  set->size += n;
+  set->nelts += n;
+  return 0;
+}
+
+static void set_free(Set *set) {
+  free(set->elts);
+  free(set);
+}
+
+static int set_find(Set *set, int x) {
+  int y = x;
+  while (y != set->elts[y].parent)
+    y = set->elts[y].parent;
+  set->elts[x].parent = y;
+  return y;
+}
+
+// joins the components rooted at x and y; the new root keeps its id,
+// or inherits the other's if it has none
+static void set_join(Set *set, int x, int y) {
+  if (set->elts[x].pseudorank > set->elts[y].pseudorank) {
+    set->elts[y].parent = x;
+    set->elts[x].surface += set->elts[y].surface;
+    if (set->elts[x].id < 0) set->elts[x].id = set->elts[y].id;
+  } else {
+    set->elts[x].parent = y;
+    set->elts[y].surface += set->elts[x].surface;
+    if (set->elts[y].id < 0) set->elts[y].id = set->elts[x].id;
+    if (set->elts[x].pseudorank == set->elts[y].pseudorank)
+      set->elts[y].pseudorank++;
+  }
+  set->nelts--;
+}
+
+#endif
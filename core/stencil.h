@@ -0,0 +1,153 @@
+#ifndef _VIDEOGRAPH_STENCIL_
+#define _VIDEOGRAPH_STENCIL_
+
+/*
+  Neighborhood stencils: a neighborhood is described by the forward
+  half of its offsets (each undirected edge is listed once, with
+  dz >= 0). Offset k of a stencil is plane k of the graphs built with
+  it: the edge from
+  voxel (x,y,z) to (x+dx,y+dy,z+dz) is stored at [z][k][y][x].
+
+  Stencils are compile-time types, so that loops over their offsets
+  are fully unrolled (see forEachEdge), with a branch-free interior
+  and a separate, bounds-checked border path.
+*/
+
+#include "videograph.h"
+
+namespace videograph {
+
+struct Offset {
+  int dx, dy, dz;
+};
+
+#define VIDEOGRAPH_STENCIL(NAME, CONNEX, SIZE, ...)                     \
+  struct NAME {                                                         \
+    enum { connex = CONNEX, size = SIZE };                              \
+    static inline const Offset &offset(int k) {                         \
+      static const Offset offsets[SIZE] = { __VA_ARGS__ };              \
+      return offsets[k];                                                \
+    }                                                                   \
+  };
+
+// 6-connexity: x, y, t
+VIDEOGRAPH_STENCIL(Stencil6, 6, 3,
+                   {1,0,0}, {0,1,0}, {0,0,1})
+
+// 6-connexity, plus a second temporal link (t+2), to bridge occlusions;
+// not a full neighborhood, so it has a code of its own (CONNEX_6T2)
+VIDEOGRAPH_STENCIL(Stencil6T2, CONNEX_6T2, 4,
+                   {1,0,0}, {0,1,0}, {0,0,1}, {0,0,2})
+
+// 8-connexity in space, plus one temporal link
+VIDEOGRAPH_STENCIL(Stencil8, 8, 5,
+                   {1,0,0}, {0,1,0}, {1,1,0}, {1,-1,0}, {0,0,1})
+
+// 18-connexity: faces and edges of the 3x3x3 cube
+VIDEOGRAPH_STENCIL(Stencil18, 18, 9,
+                   {1,0,0}, {0,1,0}, {1,1,0}, {1,-1,0},
+                   {0,0,1}, {1,0,1}, {0,1,1}, {-1,0,1}, {0,-1,1})
+
+// 26-connexity: the full 3x3x3 cube
+VIDEOGRAPH_STENCIL(Stencil26, 26, 13,
+                   {1,0,0}, {0,1,0}, {1,1,0}, {1,-1,0},
+                   {0,0,1}, {1,0,1}, {0,1,1}, {1,1,1}, {1,-1,1},
+                   {-1,0,1}, {0,-1,1}, {-1,-1,1}, {-1,1,1})
+
+#undef VIDEOGRAPH_STENCIL
+
+// calls f with the stencil type matching a connexity;
+// returns ERROR_CONNEX if there is none
+template <class F>
+static inline long withStencil(int connex, F &f) {
+  switch (connex) {
+  case 6: return f(Stencil6());
+  case CONNEX_6T2: return f(Stencil6T2());
+  case 8: return f(Stencil8());
+  case 18: return f(Stencil18());
+  case 26: return f(Stencil26());
+  }
+  return ERROR_CONNEX;
+}
+
+// margins of a stencil: the interior of a LxHxW volume is
+// [xlo,W-xhi) x [ylo,H-yhi) x [0,L-zhi), where all its edges are valid
+template <class S>
+struct Margins {
+  int xlo, xhi, ylo, yhi, zhi;
+  Margins() : xlo(0), xhi(0), ylo(0), yhi(0), zhi(0) {
+    for (int k = 0; k < S::size; k++) {
+      const Offset &o = S::offset(k);
+      if (-o.dx > xlo) xlo = -o.dx;
+      if (o.dx > xhi) xhi = o.dx;
+      if (-o.dy > ylo) ylo = -o.dy;
+      if (o.dy > yhi) yhi = o.dy;
+      if (o.dz > zhi) zhi = o.dz;
+    }
+  }
+};
+
+// visits all valid edges of a LxHxW volume, in raster order of their
+// first voxel (and stencil order): f(k, x, y, z, i, j), with i and j
+// the linear indices of the two voxels; the edges starting in rows
+// [r0,r1) of the L*H rows (row r = z*H + y) are visited
+template <class S, class F>
+static inline void forEachEdgeRows(long length, long height, long width,
+                                   long r0, long r1, F &f) {
+  Margins<S> m;
+  long plane = height*width;
+  long x,y,z,r;
+  int k;
+  for (r = r0; r < r1; r++) {
+    z = r / height;
+    y = r % height;
+    bool zin = (z + m.zhi < length);
+    long row = r*width;
+    if (zin && y >= m.ylo && y < height-m.yhi) {
+      // border (left), interior (no checks), border (right)
+      long xend = width-m.xhi;
+      for (x = 0; x < m.xlo && x < width; x++) {
+        for (k = 0; k < S::size; k++) {
+          const Offset &o = S::offset(k);
+          if (x+o.dx < 0 || x+o.dx >= width) continue;
+          f(k, x, y, z, row+x, row+x + o.dz*plane + o.dy*width + o.dx);
+        }
+      }
+      for (x = m.xlo; x < xend; x++) {
+        for (k = 0; k < S::size; k++) {
+          const Offset &o = S::offset(k);
+          f(k, x, y, z, row+x, row+x + o.dz*plane + o.dy*width + o.dx);
+        }
+      }
+      for (x = (xend > m.xlo) ? xend : m.xlo; x < width; x++) {
+        for (k = 0; k < S::size; k++) {
+          const Offset &o = S::offset(k);
+          if (x+o.dx < 0 || x+o.dx >= width) continue;
+          f(k, x, y, z, row+x, row+x + o.dz*plane + o.dy*width + o.dx);
+        }
+      }
+    } else {
+      // border rows/frames: all edges are checked
+      for (x = 0; x < width; x++) {
+        for (k = 0; k < S::size; k++) {
+          const Offset &o = S::offset(k);
+          if (x+o.dx < 0 || x+o.dx >= width) continue;
+          if (y+o.dy < 0 || y+o.dy >= height) continue;
+          if (z+o.dz < 0 || z+o.dz >= length) continue;
+          f(k, x, y, z, row+x, row+x + o.dz*plane + o.dy*width + o.dx);
+        }
+      }
+    }
+  }
+}
+
+// same, visiting the edges starting in frames [z0,z1)
+template <class S, class F>
+static inline void forEachEdge(long length, long height, long width,
+                               long z0, long z1, F &f) {
+  forEachEdgeRows<S>(length, height, width, z0*height, z1*height, f);
+}
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <vector>
+#include <new>
+
+#include "stream.h"
+#include "set.h"
+#include "stencil.h"
+#include "segment.h"
+
+namespace videograph {
+
+template <typename real>
+struct Stream<real>::State {
+  long nmaps;
+  long length, height, width;
+  long first;                  // first frame not retired
+  Set *set;                    // forest of the voxels of frames [first,length)
+  std::vector<real> threshold; // adaptive threshold of each root
+  int nextid;                  // next component id
+  std::vector<real> graph;     // graph of the last chunk (reused)
+  std::vector<Edge> edges;     // new edges of the last chunk (reused)
+};
+
+template <typename real>
+Stream<real>::Stream(const StreamOptions &options)
+  : options_(options), state_(new State) {
+  state_->nmaps = stencilplanes(options.connex);
+  state_->length = 0;
+  state_->height = 0;
+  state_->width = 0;
+  state_->first = 0;
+  state_->set = NULL;
+  state_->nextid = 0;
+}
+
+template <typename real>
+Stream<real>::~Stream() {
+  if (state_->set) set_free(state_->set);
+  delete state_;
+}
+
+template <typename real>
+Volume Stream<real>::volume() const {
+  Volume vol = {state_->length, state_->height, state_->width};
+  return vol;
+}
+
+template <typename real>
+long Stream<real>::retired() const {
+  return state_->first;
+}
+
+template <typename real>
+long Stream<real>::ncomps() const {
+  return state_->set ? state_->set->nelts : 0;
+}
+
+template <typename real>
+template <typename T>
+long Stream<real>::append(const T *frames, const Video &v, long overlap) {
+  State &s = *state_;
+  if (s.nmaps < 0) return s.nmaps;
+  if (v.length <= 0 || v.height <= 0 || v.width <= 0 || v.channels <= 0) return ERROR_DIMS;
+  if (s.length > 0 && (v.height != s.height || v.width != s.width)) return ERROR_DIMS;
+  if (overlap < 0 || overlap > s.length - s.first || overlap >= v.length) return ERROR_ARG;
+  long plane = v.height*v.width;
+  long nnew = (v.length - overlap)*plane;
+  long nold = (s.length - s.first)*plane;
+  if ((double)nold + nnew > INT_MAX) return ERROR_DIMS;
+
+  // buffers (allocated before the state is changed)
+  try {
+    s.graph.resize(v.length*s.nmaps*plane);
+    s.edges.resize(v.length*s.nmaps*plane);
+    s.threshold.resize(nold + nnew, (real)options_.thres);
+  } catch (const std::bad_alloc &) {
+    return ERROR_MEMORY;
+  }
+
+  // weight the edges of the new frames only
+  int status = appendgraph(&s.graph[0], frames, v, overlap, options_.connex, options_.dt);
+  if (status < 0) return status;
+
+  // extract them, with voxels numbered from the first frame not
+  // retired, and sort them
+  int nedges = 0;
+  long base = nold - overlap*plane;
+  ExtractEdges<real> extract = {&s.edges[0], &nedges, (const real *)&s.graph[0],
+                                v.length, v.height, v.width, overlap, base};
+  withStencil(options_.connex, extract);
+  sort_edges(&s.edges[0], nedges);
+
+  // extend the forest with the new voxels
+  if (!s.set) {
+    s.set = set_new(nnew);
+    if (!s.set) return ERROR_MEMORY;
+  } else if (set_grow(s.set, nnew) < 0) {
+    return ERROR_MEMORY;
+  }
+  s.length += v.length - overlap;
+  s.height = v.height;
+  s.width = v.width;
+
+  // merge, and post process small components, along the new edges
+  EdgeList list = {&s.edges[0]};
+  mergeedges(s.set, &s.threshold[0], list, 0, nedges, (real)options_.thres, options_.adaptive);
+  mergesmall(s.set, list, 0, nedges, options_.minsize);
+  return s.set->nelts;
+}
+
+template <typename real>
+template <class Writer>
+int Stream<real>::output(Writer &writer, long first, long count) {
+  State &s = *state_;
+  if (first < s.first || count <= 0 || first + count > s.length) return ERROR_ARG;
+  int status = writer.begin();
+  if (status < 0) return status;
+  Volume vol = {count, s.height, s.width};
+  videograph::writelabels(writer, s.set, vol, (first - s.first)*s.height*s.width, &s.nextid);
+  return writer.finish();
+}
+
+template <typename real>
+int Stream<real>::labels(real *dst, long first, long count) {
+  DenseWriter<real> writer = {dst};
+  return output(writer, first, count);
+}
+
+template <typename real>
+int Stream<real>::labels(Runs *dst, long first, long count) {
+  Volume vol = {count, state_->height, state_->width};
+  RunWriter writer(dst, vol);
+  return output(writer, first, count);
+}
+
+template <typename real>
+int Stream<real>::retire(long nframes) {
+  State &s = *state_;
+  if (nframes < 0 || nframes > s.length - s.first) return ERROR_ARG;
+  if (nframes == 0) return OK;
+  Set *set = s.set;
+  int cut = nframes*s.height*s.width;
+  int i;
+
+  // point every voxel left to its root; a component rooted in the
+  // retired frames is re-rooted on its first voxel left, which takes
+  // over the root's rank, size, id and threshold
+  for (i = cut; i < set->size; i++) {
+    int root = set_find(set, i);
+    if (root < cut) {
+      set->elts[i] = set->elts[root];
+      set->elts[i].parent = i;
+      set->elts[root].parent = i;
+      s.threshold[i] = s.threshold[root];
+    }
+  }
+
+  // shift the voxels left to the start of the forest
+  int nelts = 0;
+  for (i = cut; i < set->size; i++) {
+    Elt e = set->elts[i];
+    e.parent -= cut;
+    if (e.parent == i - cut) nelts++;
+    set->elts[i - cut] = e;
+  }
+  set->size -= cut;
+  set->nelts = nelts;
+  s.threshold.erase(s.threshold.begin(), s.threshold.begin() + cut);
+  s.first += nframes;
+  return OK;
+}
+
+template class Stream<float>;
+template class Stream<double>;
+
+#define VIDEOGRAPH_INSTANTIATE_APPEND(real, T)                          \
+  template long Stream<real>::append<T>(const T *, const Video &, long);
+
+VIDEOGRAPH_INSTANTIATE_APPEND(float, float)
+VIDEOGRAPH_INSTANTIATE_APPEND(float, unsigned char)
+VIDEOGRAPH_INSTANTIATE_APPEND(double, double)
+VIDEOGRAPH_INSTANTIATE_APPEND(double, unsigned char)
+
+}
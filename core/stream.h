@@ -0,0 +1,88 @@
+#ifndef _VIDEOGRAPH_STREAM_
+#define _VIDEOGRAPH_STREAM_
+
+/*
+  videograph stream: incremental segmentation of a video whose frames
+  arrive over time (live processing).
+
+  Frames are appended in chunks. Only the edges of the new frames are
+  weighted, sorted and merged: their spatial edges, and the temporal
+  edges linking them to the last frames already appended (see
+  appendgraph). The disjoint-set forest (and the adaptive thresholds)
+  of all the frames appended so far is kept, and extended with the
+  new frames, so that the cost of an append only depends on the size
+  of the chunk, not on the length of the video.
+
+  Each batch of edges is merged in weight order, as in segmentmst,
+  but batches are merged in arrival order: the result approximates
+  segmentmst on the whole video (it is identical for a single chunk).
+  Small components are merged along the edges of each batch.
+
+  Labels are component ids, handed out in order of first output: a
+  component keeps its id as it grows over new frames; when two
+  components merge, one of their ids is kept. The forest holds every
+  frame appended (16 bytes per voxel, plus a threshold), until it is
+  retired: a live stream retires its oldest frames as it goes, so that
+  it keeps a window of frames (at most 2^31-1 voxels) whatever the
+  length of the video. Frames keep their index (from the start of the
+  stream), and components their id, across retirements.
+*/
+
+#include "videograph.h"
+
+namespace videograph {
+
+// stream parameters
+struct StreamOptions {
+  int connex;                  // 6 | CONNEX_6T2 | 8 | 18 | 26 (see stencil.h)
+  char dt;                     // distance: 'e' | 'a' | 'm'
+  double thres;                // segmentmst threshold
+  int minsize;                 // segmentmst min component size
+  bool adaptive;               // segmentmst adaptive threshold
+
+  StreamOptions()
+    : connex(6), dt('e'), thres(3), minsize(20), adaptive(true) {}
+};
+
+template <typename real>
+class Stream {
+public:
+  explicit Stream(const StreamOptions &options);
+  ~Stream();
+
+  // appends a chunk of frames (LxKxHxW, any strides, see Video): its
+  // first overlap frames are the last overlap frames already appended
+  // (overlap >= 1 links the new frames in time to the previous ones;
+  // more is needed for stencils reaching further back in time, see
+  // stencil.h), the following ones are new; all chunks must have the
+  // same HxW. Returns the number of components, or a negative status
+  template <typename T>
+  long append(const T *frames, const Video &v, long overlap);
+
+  // writes the labels of frames [first,first+count) (count*H*W
+  // elements, frames not retired), densely or as runs
+  int labels(real *dst, long first, long count);
+  int labels(Runs *dst, long first, long count);
+
+  // drops the oldest nframes frames (of those not retired yet) from the
+  // forest; components living on in the remaining frames keep their id
+  int retire(long nframes);
+
+  Volume volume() const;       // dims of the frames appended (LxHxW)
+  long retired() const;        // number of frames retired
+  long ncomps() const;         // number of components
+
+private:
+  struct State;
+  template <class Writer> int output(Writer &writer, long first, long count);
+
+  StreamOptions options_;
+  State *state_;
+
+  Stream(const Stream &);
+  Stream &operator=(const Stream &);
+};
+
+}
+
+#endif
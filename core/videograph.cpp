@@ -0,0 +1,1282 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "videograph.h"
+#include "set.h"
+#include "stencil.h"
+#include "segment.h"
+
+#define square(x) ((x)*(x))
+#define epsilon 1e-8
+
+namespace videograph {
+
+const char *errorstring(int status) {
+  switch (status) {
+  case OK: return "no error";
+  case ERROR_DIMS: return "inconsistent or unsupported dimensions";
+  case ERROR_CONNEX: return "unsupported connexity";
+  case ERROR_ARG: return "invalid argument";
+  case ERROR_MEMORY: return "allocation failed";
+  case ERROR_IO: return "cannot read or write file";
+  case ERROR_FORMAT: return "not a valid graph file";
+  }
+  return "unknown error";
+}
+
+// random number in [0,1], from a per-call seed (re-entrant)
+static inline float rand0to1(unsigned int *seed) {
+  return (float)rand_r(seed)/(float)RAND_MAX;
+}
+
+/***********************************************************
+ * graph construction
+ ***********************************************************/
+
+template <typename real, char DT, typename T>
+static inline real ndiff(const T *img, const Video &v,
+                         long x1, long y1, long z1, long x2, long y2, long z2) {
+  real dist  = 0;
+  real dot   = 0;
+  real normx = 0;
+  real normy = 0;
+  real res = 0;
+  const T *p1 = img + z1*v.sz + y1*v.sy + x1*v.sx;
+  const T *p2 = img + z2*v.sz + y2*v.sy + x2*v.sx;
+  long i;
+  for (i=0; i<v.channels; i++) {
+    // convert on the fly: uint8 inputs are never copied to real
+    real a = (real)p1[i*v.sk];
+    real b = (real)p2[i*v.sk];
+    if (DT == 'e') {
+      dist  += square( a - b );
+    } else if (DT == 'm') {
+      real tmp = fabs( a - b );
+      if (tmp > dist) {
+        dist = tmp;
+      }
+    } else if (DT == 'a') {
+      dot   += a * b;
+      normx += square(a);
+      normy += square(b);
+    }
+  }
+  if (DT == 'e') res = sqrt(dist);
+  else if (DT == 'a') res = acos(dot/(sqrt(normx)*sqrt(normy) + epsilon));
+  else if (DT == 'm') res = dist;
+  return res;
+}
+
+// weights one edge of plane k, starting at voxel (x,y,z), if it ends
+// at voxel j >= jmin (only checked if CHECK)
+template <class S, typename real, typename T, char DT, bool CHECK>
+struct WeightEdge {
+  real *dst;
+  const T *src;
+  const Video *v;
+  long jmin;
+  inline void operator()(int k, long x, long y, long z, long, long j) {
+    if (CHECK && j < jmin) return;
+    const Offset &o = S::offset(k);
+    dst[((z*S::size+k)*v->height+y)*v->width+x] = ndiff<real,DT>(src, *v, x, y, z,
+                                                                 x+o.dx, y+o.dy, z+o.dz);
+  }
+};
+
+// weights the edges ending in frames [overlap,length)
+template <typename real, typename T, char DT>
+struct BuildGraph {
+  real *dst;
+  const T *src;
+  const Video *v;
+  long overlap;
+  template <class S> int operator()(S) {
+    // fill output with 0 (which means non-valid edge)
+    memset(dst, 0, v->length*S::size*v->height*v->width*sizeof(real));
+    // edges starting in frames [overlap,length) all end in them; those
+    // ending there from before start at most zhi frames before, and
+    // are the only ones checked
+    long z0 = overlap - Margins<S>().zhi;
+    if (z0 < 0) z0 = 0;
+    long jmin = overlap*v->height*v->width;
+    WeightEdge<S, real, T, DT, true> border = {dst, src, v, jmin};
+    forEachEdge<S>(v->length, v->height, v->width, z0, overlap, border);
+    WeightEdge<S, real, T, DT, false> weight = {dst, src, v, jmin};
+    forEachEdge<S>(v->length, v->height, v->width, overlap, v->length, weight);
+    return OK;
+  }
+};
+
+template <typename real, typename T, char DT>
+static int buildgraph(real *dst, const T *src, const Video &v, long overlap, int connex) {
+  BuildGraph<real, T, DT> build = {dst, src, &v, overlap};
+  return withStencil(connex, build);
+}
+
+template <typename real, typename T>
+int appendgraph(real *dst_data, const T *src_data, const Video &v, long overlap,
+                int connex, char dt) {
+  if (v.length <= 0 || v.height <= 0 || v.width <= 0 || v.channels <= 0) return ERROR_DIMS;
+  if (overlap < 0 || overlap >= v.length) return ERROR_ARG;
+
+  // compute the edge weights of the new frames
+  switch (dt) {
+  case 'e': return buildgraph<real, T, 'e'>(dst_data, src_data, v, overlap, connex);
+  case 'a': return buildgraph<real, T, 'a'>(dst_data, src_data, v, overlap, connex);
+  case 'm': return buildgraph<real, T, 'm'>(dst_data, src_data, v, overlap, connex);
+  }
+  return ERROR_ARG;
+}
+
+template <typename real, typename T>
+int graph(real *dst_data, const T *src_data, const Video &v, int connex, char dt) {
+  return appendgraph(dst_data, src_data, v, 0, connex, dt);
+}
+
+int stencilplanes(int connex) {
+  switch (connex) {
+  case 6: return Stencil6::size;
+  case CONNEX_6T2: return Stencil6T2::size;
+  case 8: return Stencil8::size;
+  case 18: return Stencil18::size;
+  case 26: return Stencil26::size;
+  }
+  return ERROR_CONNEX;
+}
+
+int stencilconnex(long nmaps) {
+  switch (nmaps) {
+  case Stencil6::size: return 6;
+  case Stencil6T2::size: return CONNEX_6T2;
+  case Stencil8::size: return 8;
+  case Stencil18::size: return 18;
+  case Stencil26::size: return 26;
+  }
+  return ERROR_CONNEX;
+}
+
+template <typename real, typename T, char DT>
+static int buildflowgraph(real *dst_data, const T *src_data, const Video &v, const real *flow_data) {
+  long length = v.length, height = v.height, width = v.width;
+
+  // fill output with 0 (which means non-valid edge)
+  memset(dst_data, 0, length*3*height*width*sizeof(real));
+
+  // build graph with 6-connexity
+  long x,y,z;
+  for (z = 0; z < length; z++) {
+    for (y = 0; y < height; y++) {
+      for (x = 0; x < width; x++) {
+        // spatial x/y edges
+        if (x < width-1) {
+          dst_data[((z*3+0)*height+y)*width+x] = ndiff<real, DT>(src_data, v,
+                                                                 x, y, z, x+1, y, z);
+        }
+        if (y < height-1) {
+          dst_data[((z*3+1)*height+y)*width+x] = ndiff<real, DT>(src_data, v,
+                                                                 x, y, z, x, y+1, z);
+        }
+        // time edges (flow-dependent)
+        if (z < length-1) {
+          real ox = flow_data[(((z+1)*2+0)*height+y)*width+x];
+          real oy = flow_data[(((z+1)*2+1)*height+y)*width+x];
+          long fx = floor(x+ox+0.5);
+          long fy = floor(y+oy+0.5);
+          if (fx >= 0 && fy >= 0 && fx < width && fy < height) {
+            dst_data[((z*3+2)*height+y)*width+x] = ndiff<real, DT>(src_data, v,
+                                                                   fx, fy, z, x, y, z+1);
+          }
+        }
+      }
+    }
+  }
+
+  return OK;
+}
+
+template <typename real, typename T>
+int flowgraph(real *dst_data, const T *src_data, const Video &v, const real *flow_data, char dt) {
+  if (v.length <= 0 || v.height <= 0 || v.width <= 0 || v.channels <= 0) return ERROR_DIMS;
+  switch (dt) {
+  case 'e': return buildflowgraph<real, T, 'e'>(dst_data, src_data, v, flow_data);
+  case 'a': return buildflowgraph<real, T, 'a'>(dst_data, src_data, v, flow_data);
+  case 'm': return buildflowgraph<real, T, 'm'>(dst_data, src_data, v, flow_data);
+  }
+  return ERROR_ARG;
+}
+
+/***********************************************************
+ * segmentation
+ ***********************************************************/
+
+// extracts the valid edges of a graph (LxPxHxW), sorted by weight;
+// returns their number
+template <typename real>
+static long sortededges(Edge **edges_out, const real *src_data, const Volume &vol, long nmaps) {
+  // dims
+  long length = vol.length;
+  long height = vol.height;
+  long width = vol.width;
+  if (length <= 0 || height <= 0 || width <= 0) return ERROR_DIMS;
+  int connex = stencilconnex(nmaps);
+  if (connex < 0) return connex;
+
+  // create edge list from graph (src)
+  Edge *edges = NULL; int nedges = 0;
+  edges = (Edge *)calloc(length*width*height*nmaps, sizeof(Edge));
+  if (!edges) return ERROR_MEMORY;
+  ExtractEdges<real> extract = {edges, &nedges, src_data, length, height, width, 0, 0};
+  withStencil(connex, extract);
+
+  // sort edges by weight
+  sort_edges(edges, nedges);
+
+  *edges_out = edges;
+  return nedges;
+}
+
+// edges of a graph file: their ends are checked as they are read (one
+// unsigned compare, hidden by the memory-bound merge loop); an end out
+// of [0,n) reads as 0, and is reported by status()
+template <typename Q>
+struct CachedEdges {
+  const int32_t *ea, *eb;
+  const Q *ew;
+  float wmin, wstep;
+  uint32_t n;
+  int *invalid;
+  inline float w(long i) const { return wmin + ew[i]*wstep; }
+  inline int a(long i) const { return end(ea[i]); }
+  inline int b(long i) const { return end(eb[i]); }
+  inline int end(int32_t v) const {
+    if ((uint32_t)v < n) return v;
+    *invalid = 1;
+    return 0;
+  }
+  int status() const { return *invalid ? ERROR_FORMAT : OK; }
+};
+
+// segments a volume from its sorted edges: merges components along the
+// min-spanning tree, then merges small components
+template <typename real, class Edges, class Writer>
+static long segmentedges(Writer &labels, const Edges &edges, long nedges, const Volume &vol,
+                         real thres, int minsize, bool adaptivethres) {
+  long n = vol.length*vol.height*vol.width;
+
+  // make a disjoint-set forest
+  Set *set = set_new(n);
+  if (!set) return ERROR_MEMORY;
+
+  // init thresholds
+  real *threshold = (real *)calloc(n, sizeof(real));
+  if (!threshold) {
+    set_free(set);
+    return ERROR_MEMORY;
+  }
+  long i;
+  for (i = 0; i < n; i++) threshold[i] = thres;
+
+  // merge, and post process small components
+  mergeedges(set, threshold, edges, 0, nedges, thres, adaptivethres);
+  mergesmall(set, edges, 0, nedges, minsize);
+
+  // edges read from a file may be invalid (see CachedEdges)
+  int status = edges.status();
+  if (status == OK) status = labels.begin();
+  if (status < 0) {
+    set_free(set);
+    free(threshold);
+    return status;
+  }
+
+  // generate output
+  writelabels(labels, set, vol, 0, NULL);
+  long ncomps = set->nelts;
+
+  // cleanup
+  set_free(set);
+  free(threshold);
+
+  status = labels.finish();
+  return (status < 0) ? status : ncomps;
+}
+
+template <typename real, class Writer>
+static long segmentgraph(Writer &labels, const real *src_data, const Volume &vol, long nmaps,
+                         real thres, int minsize, bool adaptivethres) {
+  Edge *edges = NULL;
+  long nedges = sortededges(&edges, src_data, vol, nmaps);
+  if (nedges < 0) return nedges;
+  EdgeList list = {edges};
+  long ncomps = segmentedges(labels, list, nedges, vol, thres, minsize, adaptivethres);
+  free(edges);
+  return ncomps;
+}
+
+template <typename real>
+long segmentmst(real *labels, const real *src_data, const Volume &vol, long nmaps,
+                real thres, int minsize, bool adaptivethres) {
+  DenseWriter<real> writer = {labels};
+  return segmentgraph(writer, src_data, vol, nmaps, thres, minsize, adaptivethres);
+}
+
+template <typename real>
+long segmentmst(Runs *labels, const real *src_data, const Volume &vol, long nmaps,
+                real thres, int minsize, bool adaptivethres) {
+  RunWriter writer(labels, vol);
+  return segmentgraph(writer, src_data, vol, nmaps, thres, minsize, adaptivethres);
+}
+
+/***********************************************************
+ * graph files
+ ***********************************************************/
+
+// on-disk header, in native byte order (a file written on a machine
+// of the other endianness fails the magic check)
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  int32_t connex;
+  int32_t quant;
+  int64_t length, height, width;
+  int64_t nedges;
+  float wmin, wstep;
+  char dt;
+  char reserved[15];
+} GraphFileHeader;
+
+static const uint32_t GRAPHFILE_MAGIC = 0x56475246;   // "VGRF"
+
+static inline size_t weightsize(int quant) {
+  return quant ? quant/8 : sizeof(float);
+}
+
+// quantizes the (sorted) weights of edges into codes of Q, over
+// [wmin,wmax]: the mapping is monotonic, so codes remain sorted
+template <typename Q>
+static void quantize(Q *codes, const Edge *edges, long nedges, float *wmin, float *wstep) {
+  const float qmax = (float)(Q)~(Q)0;
+  float lo = FLT_MAX, hi = -FLT_MAX;
+  long i;
+  for (i = 0; i < nedges; i++) {
+    if (edges[i].w < lo) lo = edges[i].w;
+    if (edges[i].w > hi) hi = edges[i].w;
+  }
+  if (nedges == 0) lo = hi = 0;
+  float step = (hi > lo) ? (hi - lo)/qmax : 0;
+  for (i = 0; i < nedges; i++) {
+    float w = edges[i].w;
+    if (!(w <= hi)) codes[i] = (Q)qmax;             // nan
+    else if (step == 0) codes[i] = 0;
+    else codes[i] = (Q)floor((w - lo)/step + 0.5f);
+  }
+  *wmin = lo;
+  *wstep = step;
+}
+
+template <typename real>
+int savegraph(const char *path, const real *graph, const Volume &vol, long nmaps,
+              char dt, int quant) {
+  if (quant != 0 && quant != 8 && quant != 16) return ERROR_ARG;
+  if (dt != 'e' && dt != 'a' && dt != 'm') return ERROR_ARG;
+
+  // sorted edges, as segmentmst would process them
+  Edge *edges = NULL;
+  long nedges = sortededges(&edges, graph, vol, nmaps);
+  if (nedges < 0) return nedges;
+
+  // split records into endpoints and weights (quantized or not)
+  GraphFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = GRAPHFILE_MAGIC;
+  header.version = GRAPHFILE_VERSION;
+  header.connex = stencilconnex(nmaps);
+  header.quant = quant;
+  header.length = vol.length;
+  header.height = vol.height;
+  header.width = vol.width;
+  header.nedges = nedges;
+  header.wmin = 0;
+  header.wstep = 1;
+  header.dt = dt;
+  int32_t *ends = (int32_t *)malloc(nedges*2*sizeof(int32_t) + 1);
+  void *weights = malloc(nedges*weightsize(quant) + 1);
+  if (!ends || !weights) {
+    free(ends); free(weights); free(edges);
+    return ERROR_MEMORY;
+  }
+  long i;
+  for (i = 0; i < nedges; i++) {
+    ends[i] = edges[i].a;
+    ends[nedges+i] = edges[i].b;
+  }
+  if (quant == 8) quantize((uint8_t *)weights, edges, nedges, &header.wmin, &header.wstep);
+  else if (quant == 16) quantize((uint16_t *)weights, edges, nedges, &header.wmin, &header.wstep);
+  else for (i = 0; i < nedges; i++) ((float *)weights)[i] = edges[i].w;
+  free(edges);
+
+  // write header, endpoints (all a, then all b), and weights
+  int status = OK;
+  FILE *file = fopen(path, "wb");
+  if (!file) status = ERROR_IO;
+  else {
+    if (fwrite(&header, sizeof(header), 1, file) != 1
+        || fwrite(ends, sizeof(int32_t), 2*nedges, file) != (size_t)(2*nedges)
+        || fwrite(weights, weightsize(quant), nedges, file) != (size_t)nedges)
+      status = ERROR_IO;
+    if (fclose(file) != 0) status = ERROR_IO;
+  }
+  free(ends);
+  free(weights);
+  return status;
+}
+
+int opengraph(const char *path, GraphFile *graph) {
+  memset(graph, 0, sizeof(GraphFile));
+
+  // map the whole file (read-only: pages are loaded on demand, and
+  // shared with all the processes reading the same file)
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return ERROR_IO;
+  struct stat st;
+  if (fstat(fd, &st) != 0) { close(fd); return ERROR_IO; }
+  size_t size = st.st_size;
+  if (size < sizeof(GraphFileHeader)) { close(fd); return ERROR_FORMAT; }
+  void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return ERROR_IO;
+#ifdef MADV_SEQUENTIAL
+  madvise(map, size, MADV_SEQUENTIAL);
+#endif
+
+  // check header, and size
+  const GraphFileHeader *header = (const GraphFileHeader *)map;
+  if (header->magic != GRAPHFILE_MAGIC || header->version != GRAPHFILE_VERSION
+      || stencilplanes(header->connex) < 0
+      || (header->quant != 0 && header->quant != 8 && header->quant != 16)
+      || header->length <= 0 || header->height <= 0 || header->width <= 0
+      || (double)header->length*header->height*header->width > INT32_MAX
+      || header->nedges < 0
+      || header->nedges > header->length*header->height*header->width*stencilplanes(header->connex)
+      || size != sizeof(GraphFileHeader)
+                 + header->nedges*(2*sizeof(int32_t) + weightsize(header->quant))) {
+    munmap(map, size);
+    return ERROR_FORMAT;
+  }
+
+  // (edge ends are checked as segmentations read them, see CachedEdges)
+
+  graph->vol.length = header->length;
+  graph->vol.height = header->height;
+  graph->vol.width = header->width;
+  graph->connex = header->connex;
+  graph->dt = header->dt;
+  graph->quant = header->quant;
+  graph->nedges = header->nedges;
+  graph->a = (const int32_t *)(header + 1);
+  graph->b = graph->a + graph->nedges;
+  graph->weights = graph->b + graph->nedges;
+  graph->wmin = header->wmin;
+  graph->wstep = header->wstep;
+  graph->map = map;
+  graph->mapsize = size;
+  return OK;
+}
+
+void closegraph(GraphFile *graph) {
+  if (graph->map) munmap(graph->map, graph->mapsize);
+  memset(graph, 0, sizeof(GraphFile));
+}
+
+template <typename Q, typename real, class Writer>
+static long segmentcachedq(Writer &labels, const GraphFile &graph,
+                           real thres, int minsize, bool adaptive) {
+  int invalid = 0;
+  uint32_t n = graph.vol.length*graph.vol.height*graph.vol.width;
+  CachedEdges<Q> edges = {graph.a, graph.b, (const Q *)graph.weights, graph.wmin, graph.wstep,
+                          n, &invalid};
+  return segmentedges(labels, edges, graph.nedges, graph.vol, thres, minsize, adaptive);
+}
+
+template <typename real, class Writer>
+static long segmentfile(Writer &labels, const GraphFile &graph, real thres, int minsize, bool adaptive) {
+  if (graph.quant == 8) return segmentcachedq<uint8_t>(labels, graph, thres, minsize, adaptive);
+  if (graph.quant == 16) return segmentcachedq<uint16_t>(labels, graph, thres, minsize, adaptive);
+  return segmentcachedq<float>(labels, graph, thres, minsize, adaptive);
+}
+
+template <typename real>
+long segmentcached(real *labels, const GraphFile &graph, real thres, int minsize, bool adaptive) {
+  if (!graph.map) return ERROR_ARG;
+  DenseWriter<real> writer = {labels};
+  return segmentfile(writer, graph, thres, minsize, adaptive);
+}
+
+template <typename real>
+long segmentcached(Runs *labels, const GraphFile &graph, real thres, int minsize, bool adaptive) {
+  if (!graph.map) return ERROR_ARG;
+  RunWriter writer(labels, graph.vol);
+  return segmentfile(writer, graph, thres, minsize, adaptive);
+}
+
+/***********************************************************
+ * post-processing
+ ***********************************************************/
+
+template <typename real>
+int colorize(real *dst_data, const real *labels, const Volume &vol,
+             real *colormap, long ncolors, long channels, unsigned int *seed) {
+  // dims
+  long length = vol.length;
+  long height = vol.height;
+  long width = vol.width;
+  long plane = height*width;
+
+  // generate output
+  long x,y,k,z;
+  for (z = 0; z < length; z++) {
+    for (y = 0; y < height; y++) {
+      for (x = 0; x < width; x++) {
+        long id = labels[(z*height+y)*width+x];
+        if (id < 0 || id >= ncolors) return ERROR_ARG;
+        real *color = colormap + id*channels;
+        if (color[0] == -1) {
+          for (k = 0; k < channels; k++) {
+            color[k] = rand0to1(seed);
+          }
+        }
+        for (k = 0; k < channels; k++) {
+          dst_data[(z*channels+k)*plane + y*width+x] = color[k];
+        }
+      }
+    }
+  }
+
+  return OK;
+}
+
+static int compare_longs(const void *p1, const void *p2) {
+  long a = *(const long *)p1, b = *(const long *)p2;
+  return (a < b) ? -1 : (a > b);
+}
+
+// dense index (0..N-1, in increasing id order) of each of n ids read
+// with a stride (labels, or the ids of runs); returns N. Ids below n
+// go through a lookup table, larger (sparse) ones are sorted: memory
+// is O(n) either way
+template <typename T>
+static long densemapstrided(const T *ids, long n, long stride, long **index_out) {
+  long i, m = 0;
+  for (i = 0; i < n; i++) {
+    if (ids[i*stride] < 0) return ERROR_ARG;
+    if (ids[i*stride] > m) m = ids[i*stride];
+  }
+  long *index = (long *)malloc(n*sizeof(long));
+  if (!index) return ERROR_MEMORY;
+  long count = 0;
+  if (m < n) {
+    long *table = (long *)malloc((m+1)*sizeof(long));
+    if (!table) { free(index); return ERROR_MEMORY; }
+    for (i = 0; i <= m; i++) table[i] = -1;
+    for (i = 0; i < n; i++) table[(long)ids[i*stride]] = 0;
+    for (i = 0; i <= m; i++) if (table[i] == 0) table[i] = count++;
+    for (i = 0; i < n; i++) index[i] = table[(long)ids[i*stride]];
+    free(table);
+  } else {
+    long *sorted = (long *)malloc(n*sizeof(long));
+    if (!sorted) { free(index); return ERROR_MEMORY; }
+    for (i = 0; i < n; i++) sorted[i] = ids[i*stride];
+    qsort(sorted, n, sizeof(long), compare_longs);
+    for (i = 0; i < n; i++) if (count == 0 || sorted[count-1] != sorted[i]) sorted[count++] = sorted[i];
+    for (i = 0; i < n; i++) {
+      long id = ids[i*stride], lo = 0, hi = count-1;
+      while (lo < hi) {
+        long mid = (lo + hi) / 2;
+        if (sorted[mid] < id) lo = mid+1;
+        else hi = mid;
+      }
+      index[i] = lo;
+    }
+    free(sorted);
+  }
+  *index_out = index;
+  return count;
+}
+
+template <typename real>
+long densemap(const real *labels, long n, long **index) {
+  return densemapstrided(labels, n, 1, index);
+}
+
+static int compare_pairs(const void *p1, const void *p2) {
+  const long *a = (const long *)p1, *b = (const long *)p2;
+  if (a[0] != b[0]) return (a[0] < b[0]) ? -1 : 1;
+  if (a[1] != b[1]) return (a[1] < b[1]) ? -1 : 1;
+  return 0;
+}
+
+// growable list of (min,max) id pairs; once an allocation failed,
+// status is ERROR_MEMORY, and further pairs are dropped
+struct PairList {
+  long *pairs;
+  long npairs, capacity;
+  int status;
+};
+
+static inline void pushpair(PairList *list, long id, long idn) {
+  if (list->status < 0) return;
+  if (list->npairs == list->capacity) {
+    long capacity = list->capacity ? 2*list->capacity : 1024;
+    long *pairs = (long *)realloc(list->pairs, 2*capacity*sizeof(long));
+    if (!pairs) { list->status = ERROR_MEMORY; return; }
+    list->pairs = pairs;
+    list->capacity = capacity;
+  }
+  list->pairs[2*list->npairs+0] = (id < idn) ? id : idn;
+  list->pairs[2*list->npairs+1] = (id < idn) ? idn : id;
+  list->npairs++;
+}
+
+// sorts pairs, and removes duplicates; returns the number left
+static long uniquepairs(long *pairs, long npairs) {
+  if (npairs) qsort(pairs, npairs, 2*sizeof(long), compare_pairs);
+  long i, n = 0;
+  for (i = 0; i < npairs; i++) {
+    if (n > 0 && pairs[2*(n-1)] == pairs[2*i] && pairs[2*(n-1)+1] == pairs[2*i+1]) continue;
+    pairs[2*n] = pairs[2*i];
+    pairs[2*n+1] = pairs[2*i+1];
+    n++;
+  }
+  return n;
+}
+
+// hands the unique pairs of list over to pairs_out; returns their
+// number, or the list's status (its pairs are then released)
+static long finishpairs(PairList *list, long **pairs_out) {
+  if (list->status < 0) {
+    free(list->pairs);
+    return list->status;
+  }
+  *pairs_out = list->pairs;
+  return uniquepairs(list->pairs, list->npairs);
+}
+
+template <typename real>
+long adjacency(const real *input_data, const Volume &vol, long **pairs_out) {
+  // dims
+  long length = vol.length;
+  long height = vol.height;
+  long width = vol.width;
+
+  // list all boundaries
+  PairList list = {NULL, 0, 0, OK};
+  long x,y,z;
+  for (z = 0; z < length; z++) {
+    for (y = 0; y < height; y++) {
+      for (x = 0; x < width; x++) {
+        long id = input_data[(height*z+y)*width+x];
+        if (x < (width-1)) {
+          long id_east = input_data[(height*z+y)*width+(x+1)];
+          if (id != id_east) pushpair(&list, id, id_east);
+        }
+        if (y < (height-1)) {
+          long id_south = input_data[(height*z+(y+1))*width+x];
+          if (id != id_south) pushpair(&list, id, id_south);
+        }
+        if (z < (length-1)) {
+          long id_next = input_data[(height*(z+1)+y)*width+x];
+          if (id != id_next) pushpair(&list, id, id_next);
+        }
+      }
+    }
+  }
+
+  return finishpairs(&list, pairs_out);
+}
+
+// turns accumulated records (sums, sizes, extents) into final records
+template <typename real>
+static void finishstats(real *stats, long ncomps) {
+  long c;
+  for (c = 0; c < ncomps; c++) {
+    real *data = stats + c*STATS_SIZE;
+
+    // normalize cx and cy, by component's size
+    long size = data[3];
+    data[0] /= size;  // cx/size
+    data[1] /= size;  // cy/size
+    data[2] /= size;  // cz/size
+
+    // extra info
+    data[12] = data[7] - data[6] + 1;     // box width
+    data[13] = data[9] - data[8] + 1;    // box height
+    data[14] = data[11] - data[10] + 1;    // box length
+    data[15] = (data[7] + data[6]) / 2;  // box center x
+    data[16] = (data[9] + data[8]) / 2;  // box center y
+    data[17] = (data[11] + data[10]) / 2;  // box center z
+  }
+}
+
+template <typename real>
+long componentstats(const real *segm_data, const Volume &vol, real **stats_out) {
+  // dims
+  long length = vol.length;
+  long height = vol.height;
+  long width = vol.width;
+
+  // dense index of each component
+  long *dense = NULL;
+  long ncomps = densemap(segm_data, length*height*width, &dense);
+  if (ncomps < 0) return ncomps;
+  real *stats = (real *)calloc(ncomps*STATS_SIZE, sizeof(real));
+  if (!stats) { free(dense); return ERROR_MEMORY; }
+
+  // (1) get components' info
+  long x,y,z;
+  for (z=0; z<length; z++) {
+    for (y=0; y<height; y++) {
+      for (x=0; x<width; x++) {
+        // get component ID
+        long segm_id = segm_data[(height*z+y)*width+x];
+        long c = dense[(height*z+y)*width+x];
+        real *data = stats + c*STATS_SIZE;
+
+        if (data[3] == 0) {
+          // first voxel: init geometry of component
+          data[0] = x+1;       // x
+          data[1] = y+1;       // y
+          data[2] = z+1;       // z
+          data[3] = 1;         // size
+          data[4] = c+1;       // dense index (row in poolcomponents)
+          data[5] = segm_id;   // hash
+          data[6] = x+1;       // left_x
+          data[7] = x+1;       // right_x
+          data[8] = y+1;       // top_y
+          data[9] = y+1;       // bottom_y
+          data[10] = z+1;       // first_z
+          data[11] = z+1;       // last_z
+        } else {
+          // update content
+          data[0] += x+1;       // x += x + 1
+          data[1] += y+1;       // y += y + 1
+          data[2] += z+1;       // z += z + 1
+          data[3] += 1;         // size += 1
+          data[6] = (x+1)<data[6] ? x+1 : data[6];   // left_x
+          data[7] = (x+1)>data[7] ? x+1 : data[7];   // right_x
+          data[8] = (y+1)<data[8] ? y+1 : data[8];   // top_y
+          data[9] = (y+1)>data[9] ? y+1 : data[9];   // bottom_y
+          data[10] = (z+1)<data[10] ? z+1 : data[10];   // first_z
+          data[11] = (z+1)>data[11] ? z+1 : data[11];   // last_z
+        }
+      }
+    }
+  }
+
+  // (2) normalize, and produce final records
+  finishstats(stats, ncomps);
+
+  // cleanup
+  free(dense);
+
+  *stats_out = stats;
+  return ncomps;
+}
+
+template <typename real>
+int poolcomponents(real *mean_data, real *max_data, real *hist_data,
+                   const long *index, long ncomps,
+                   const real *feats_data, const Video &v,
+                   int nbins, real hmin, real hmax) {
+  // dims
+  long length = v.length, height = v.height, width = v.width;
+  long channels = v.channels;
+  long n = length*height*width;
+  if (nbins > 0 && !hist_data) return ERROR_ARG;
+
+  // histogram range: if not given, that of the (non-NaN) features
+  if (nbins > 0 && (isnan(hmin) || isnan(hmax))) {
+    real lo = std::numeric_limits<real>::infinity(), hi = -lo;
+    long k;
+    #pragma omp parallel for reduction(min:lo) reduction(max:hi)
+    for (k = 0; k < channels; k++) {
+      long x, y, z;
+      for (z = 0; z < length; z++) {
+        const real *plane = feats_data + z*v.sz + k*v.sk;
+        for (y = 0; y < height; y++) {
+          for (x = 0; x < width; x++) {
+            real val = plane[y*v.sy + x*v.sx];
+            if (val < lo) lo = val;
+            if (val > hi) hi = val;
+          }
+        }
+      }
+    }
+    if (isnan(hmin)) hmin = lo;
+    if (isnan(hmax)) hmax = hi;
+    if (hmax <= hmin) hmax = hmin + 1;
+  }
+  if (nbins > 0 && !(hmax > hmin)) return ERROR_ARG;
+
+  // size of each component
+  long *counts = (long *)calloc(ncomps, sizeof(long));
+  if (!counts) return ERROR_MEMORY;
+  long i;
+  for (i = 0; i < n; i++) counts[index[i]]++;
+  if (nbins > 0) memset(hist_data, 0, ncomps*channels*nbins*sizeof(real));
+
+  // pool all features, each thread owning a set of channels
+  long k;
+  int failed = 0;
+  #pragma omp parallel for reduction(|:failed)
+  for (k = 0; k < channels; k++) {
+    double *sums = (double *)calloc(ncomps, sizeof(double));
+    real *maxs = (real *)malloc(ncomps*sizeof(real));
+    if (!sums || !maxs) {
+      free(sums); free(maxs);
+      failed |= 1;
+      continue;
+    }
+    long c, x, y, z, j = 0;
+    for (c = 0; c < ncomps; c++) maxs[c] = -std::numeric_limits<real>::infinity();
+    real binscale = (nbins > 0) ? nbins/(hmax-hmin) : 0;
+    for (z = 0; z < length; z++) {
+      const real *plane = feats_data + z*v.sz + k*v.sk;
+      for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++, j++) {
+          real val = plane[y*v.sy + x*v.sx];
+          long id = index[j];
+          sums[id] += val;
+          if (val > maxs[id]) maxs[id] = val;
+          if (nbins > 0 && !isnan(val)) {
+            // clamp before converting (out of range values saturate)
+            real pos = (val-hmin)*binscale;
+            long bin = (pos <= 0) ? 0 : (pos >= nbins) ? nbins-1 : (long)pos;
+            hist_data[(id*channels+k)*nbins+bin] += 1;
+          }
+        }
+      }
+    }
+    for (c = 0; c < ncomps; c++) {
+      mean_data[c*channels+k] = sums[c] / counts[c];
+      max_data[c*channels+k] = maxs[c];
+    }
+    free(sums);
+    free(maxs);
+  }
+
+  // cleanup
+  free(counts);
+
+  return failed ? ERROR_MEMORY : OK;
+}
+
+/***********************************************************
+ * run-length encoded labels
+ ***********************************************************/
+
+// checks that the runs of each row tile it: ends strictly increasing,
+// up to width, and non-negative ids
+static int checkruns(const Runs &r) {
+  long nrows = r.vol.length*r.vol.height;
+  long width = r.vol.width;
+  if (nrows <= 0 || width <= 0 || !r.rows || (r.nruns && !r.runs)) return ERROR_ARG;
+  if (r.rows[0] != 0 || r.rows[nrows] != r.nruns) return ERROR_ARG;
+  long row, k;
+  for (row = 0; row < nrows; row++) {
+    if (r.rows[row+1] <= r.rows[row]) return ERROR_ARG;
+    long x = 0;
+    for (k = r.rows[row]; k < r.rows[row+1]; k++) {
+      if (r.runs[2*k] <= x || r.runs[2*k+1] < 0) return ERROR_ARG;
+      x = r.runs[2*k];
+    }
+    if (x != width) return ERROR_ARG;
+  }
+  return OK;
+}
+
+template <typename real>
+long encoderuns(Runs *runs, const real *labels, const Volume &vol) {
+  if (vol.length <= 0 || vol.height <= 0 || vol.width <= 0) return ERROR_DIMS;
+  RunWriter writer(runs, vol);
+  int status = writer.begin();
+  if (status < 0) return status;
+  long x, row, nrows = vol.length*vol.height;
+  for (row = 0; row < nrows && writer.status == OK; row++) {
+    const real *line = labels + row*vol.width;
+    for (x = 0; x < vol.width; x++) {
+      // ids must be integers in [0,2^31)
+      if (!(line[x] >= 0 && line[x] <= INT32_MAX)) { writer.status = ERROR_ARG; break; }
+      writer.put(x, (int)line[x]);
+    }
+    writer.endrow();
+  }
+  status = writer.finish();
+  return (status < 0) ? status : runs->nruns;
+}
+
+template <typename real>
+int decoderuns(real *labels, const Runs &runs) {
+  int status = checkruns(runs);
+  if (status < 0) return status;
+  long row, k, nrows = runs.vol.length*runs.vol.height;
+  for (row = 0; row < nrows; row++) {
+    real *line = labels + row*runs.vol.width;
+    long x = 0;
+    for (k = runs.rows[row]; k < runs.rows[row+1]; k++) {
+      real id = runs.runs[2*k+1];
+      for (; x < runs.runs[2*k]; x++) line[x] = id;
+    }
+  }
+  return OK;
+}
+
+template <typename real>
+int colorize(real *dst_data, const Runs &labels, real *colormap, long ncolors, long channels,
+             unsigned int *seed) {
+  int status = checkruns(labels);
+  if (status < 0) return status;
+  long height = labels.vol.height;
+  long width = labels.vol.width;
+  long plane = height*width;
+
+  // one color lookup per run, then contiguous fills
+  long row, k, c, x, nrows = labels.vol.length*height;
+  for (row = 0; row < nrows; row++) {
+    long z = row / height, y = row % height;
+    long x0 = 0;
+    for (k = labels.rows[row]; k < labels.rows[row+1]; k++) {
+      long id = labels.runs[2*k+1], x1 = labels.runs[2*k];
+      if (id >= ncolors) return ERROR_ARG;
+      real *color = colormap + id*channels;
+      if (color[0] == -1) {
+        for (c = 0; c < channels; c++) {
+          color[c] = rand0to1(seed);
+        }
+      }
+      for (c = 0; c < channels; c++) {
+        real *line = dst_data + (z*channels+c)*plane + y*width;
+        for (x = x0; x < x1; x++) line[x] = color[c];
+      }
+      x0 = x1;
+    }
+  }
+
+  return OK;
+}
+
+// pushes the pairs of overlapping runs of two rows, with distinct ids
+static void pushoverlaps(const Runs &r, long rowa, long rowb, PairList *list) {
+  long i = r.rows[rowa], iend = r.rows[rowa+1];
+  long j = r.rows[rowb], jend = r.rows[rowb+1];
+  while (i < iend && j < jend) {
+    long ida = r.runs[2*i+1], idb = r.runs[2*j+1];
+    if (ida != idb) pushpair(list, ida, idb);
+    long enda = r.runs[2*i], endb = r.runs[2*j];
+    if (enda <= endb) i++;
+    if (endb <= enda) j++;
+  }
+}
+
+long adjacency(const Runs &labels, long **pairs_out) {
+  int status = checkruns(labels);
+  if (status < 0) return status;
+  long length = labels.vol.length;
+  long height = labels.vol.height;
+
+  // boundaries: between consecutive runs of a row, and between
+  // overlapping runs of the next row (south) and next frame (same row)
+  PairList list = {NULL, 0, 0, OK};
+  long row, k, nrows = length*height;
+  for (row = 0; row < nrows; row++) {
+    for (k = labels.rows[row]+1; k < labels.rows[row+1]; k++) {
+      if (labels.runs[2*k+1] != labels.runs[2*k-1])
+        pushpair(&list, labels.runs[2*k-1], labels.runs[2*k+1]);
+    }
+    if (row % height < height-1) pushoverlaps(labels, row, row+1, &list);
+    if (row / height < length-1) pushoverlaps(labels, row, row+height, &list);
+  }
+
+  return finishpairs(&list, pairs_out);
+}
+
+template <typename real>
+long componentstats(const Runs &labels, real **stats_out) {
+  int status = checkruns(labels);
+  if (status < 0) return status;
+  long height = labels.vol.height;
+
+  // dense index of each component (ids are every other entry of runs)
+  long *dense = NULL;
+  long ncomps = densemapstrided(labels.runs+1, labels.nruns, 2, &dense);
+  if (ncomps < 0) return ncomps;
+  real *stats = (real *)calloc(ncomps*STATS_SIZE, sizeof(real));
+  if (!stats) { free(dense); return ERROR_MEMORY; }
+
+  // (1) get components' info, one run at a time: a run covers
+  // x in [x0,x1), and adds x0+1 + ... + x1 to the sum of x+1
+  long row, k, nrows = labels.vol.length*height;
+  for (row = 0; row < nrows; row++) {
+    long z = row / height, y = row % height;
+    long x0 = 0;
+    for (k = labels.rows[row]; k < labels.rows[row+1]; k++) {
+      long segm_id = labels.runs[2*k+1], x1 = labels.runs[2*k];
+      long len = x1 - x0;
+      real *data = stats + dense[k]*STATS_SIZE;
+      if (data[3] == 0) {
+        data[4] = dense[k]+1; // dense index (row in poolcomponents)
+        data[5] = segm_id;   // hash
+        data[6] = x0+1;       // left_x
+        data[7] = x1;         // right_x
+        data[8] = y+1;        // top_y
+        data[9] = y+1;        // bottom_y
+        data[10] = z+1;       // first_z
+        data[11] = z+1;       // last_z
+      } else {
+        data[6] = (x0+1)<data[6] ? x0+1 : data[6];   // left_x
+        data[7] = x1>data[7] ? x1 : data[7];         // right_x
+        data[8] = (y+1)<data[8] ? y+1 : data[8];     // top_y
+        data[9] = (y+1)>data[9] ? y+1 : data[9];     // bottom_y
+        data[10] = (z+1)<data[10] ? z+1 : data[10];  // first_z
+        data[11] = (z+1)>data[11] ? z+1 : data[11];  // last_z
+      }
+      data[0] += (real)((x0+1+x1)*len/2);  // x
+      data[1] += (real)(len*(y+1));        // y
+      data[2] += (real)(len*(z+1));        // z
+      data[3] += len;                      // size
+      x0 = x1;
+    }
+  }
+
+  // (2) normalize, and produce final records
+  finishstats(stats, ncomps);
+
+  // cleanup
+  free(dense);
+
+  *stats_out = stats;
+  return ncomps;
+}
+
+/***********************************************************
+ * connected components
+ ***********************************************************/
+
+// disjoint-set forest over voxel indices, where a root is always the
+// smallest index of its tree (parent[x] <= x): unions that only touch
+// one block of frames can then run concurrently with other blocks
+static inline long forest_find(long *parent, long x) {
+  long root = x;
+  while (parent[root] != root) root = parent[root];
+  while (parent[x] != root) { long next = parent[x]; parent[x] = root; x = next; }
+  return root;
+}
+
+static inline long forest_root(long *parent, long x) {
+  while (parent[x] != x) x = parent[x];
+  return x;
+}
+
+static inline void forest_union(long *parent, long a, long b) {
+  a = forest_find(parent, a);
+  b = forest_find(parent, b);
+  if (a < b) parent[b] = a;
+  else if (b < a) parent[a] = b;
+}
+
+// unions voxels of equal labels, for edges within voxels [start, end)
+template <typename real>
+struct UnionBlock {
+  long *parent;
+  const real *labels;
+  long start, end;
+  inline void operator()(int, long, long, long, long i, long j) {
+    if (j >= start && j < end && labels[i] == labels[j]) forest_union(parent, i, j);
+  }
+};
+
+// links roots of voxels of equal labels, for edges crossing voxel
+// start (one end before it, the other after); linked roots are recorded
+template <typename real>
+struct LinkBlocks {
+  long *parent;
+  const real *labels;
+  long start;
+  long *linked;
+  long *nlinked;
+  inline void operator()(int, long, long, long, long i, long j) {
+    if ((i < start) == (j < start) || labels[i] != labels[j]) return;
+    long ri = forest_root(parent, i);
+    long rj = forest_root(parent, j);
+    if (ri == rj) return;
+    if (ri < rj) { parent[rj] = ri; linked[(*nlinked)++] = rj; }
+    else { parent[ri] = rj; linked[(*nlinked)++] = ri; }
+  }
+};
+
+template <typename real>
+struct LabelComponents {
+  real *dst_data;
+  const real *segm_data;
+  const Volume *vol;
+  template <class S> long operator()(S);
+};
+
+template <typename real>
+long connectedcomponents(real *dst_data, const real *segm_data, const Volume &vol, int connex) {
+  if (vol.length <= 0 || vol.height <= 0 || vol.width <= 0) return ERROR_DIMS;
+  LabelComponents<real> label = {dst_data, segm_data, &vol};
+  return withStencil(connex, label);
+}
+
+template <typename real>
+template <class S>
+long LabelComponents<real>::operator()(S) {
+  // dims
+  long length = vol->length;
+  long height = vol->height;
+  long width = vol->width;
+  long nrows = length*height;
+  long n = nrows*width;
+
+  // split video into blocks of rows (of its L*H rows), one per thread,
+  // so that short (or single-frame) videos are split within frames
+  long nblocks = 1;
+#ifdef _OPENMP
+  nblocks = omp_get_max_threads();
+#endif
+  if (nblocks > nrows) nblocks = nrows;
+
+  // reach of the (valid) edges, in rows: the edges crossing a block
+  // boundary r start in rows [r-fwd, r+back)
+  long fwd = 0, back = 0;
+  int k;
+  for (k = 0; k < S::size; k++) {
+    const Offset &o = S::offset(k);
+    if (o.dz >= length) continue;
+    long d = o.dz*height + o.dy;
+    if (d > fwd) fwd = d;
+    if (-d > back) back = -d;
+  }
+  long maxlinks = (nblocks-1)*(fwd+back)*width*S::size;
+  if (maxlinks > n) maxlinks = n;
+  long *parent = (long *)malloc(n*sizeof(long));
+  long *linked = (long *)malloc((maxlinks ? maxlinks : 1)*sizeof(long));
+  long *block_r = (long *)malloc((nblocks+1)*sizeof(long));
+  long *block_roots = (long *)calloc(nblocks+1, sizeof(long));
+  if (!parent || !linked || !block_r || !block_roots) {
+    free(parent); free(linked); free(block_r); free(block_roots);
+    return ERROR_MEMORY;
+  }
+  long b;
+  for (b = 0; b <= nblocks; b++) block_r[b] = (nrows*b)/nblocks;
+
+  // (1) label each block independently
+  #pragma omp parallel for schedule(static,1)
+  for (b = 0; b < nblocks; b++) {
+    long start = block_r[b]*width, end = block_r[b+1]*width, i;
+    for (i = start; i < end; i++) parent[i] = i;
+    UnionBlock<real> unite = {parent, segm_data, start, end};
+    forEachEdgeRows<S>(length, height, width, block_r[b], block_r[b+1], unite);
+  }
+
+  // (2) merge blocks, along edges that cross their boundaries:
+  // only roots are linked here (no path compression)
+  long nlinked = 0;
+  for (b = 1; b < nblocks; b++) {
+    long r0 = block_r[b] - fwd, r1 = block_r[b] + back;
+    LinkBlocks<real> link = {parent, segm_data, block_r[b]*width, linked, &nlinked};
+    forEachEdgeRows<S>(length, height, width, (r0 > 0) ? r0 : 0,
+                       (r1 < nrows) ? r1 : nrows, link);
+  }
+
+  // (3) point linked roots to their final root, then every voxel
+  // to its final root (parent[x] <= x, so one ordered pass per block)
+  long l;
+  for (l = 0; l < nlinked; l++) forest_find(parent, linked[l]);
+  #pragma omp parallel for schedule(static,1)
+  for (b = 0; b < nblocks; b++) {
+    long start = block_r[b]*width, end = block_r[b+1]*width, i;
+    for (i = start; i < end; i++) {
+      long p = parent[i];
+      if (p != i && p >= start) parent[i] = parent[p];
+    }
+  }
+
+  // (4) compact root ids into 1..N, in raster order
+  #pragma omp parallel for schedule(static,1)
+  for (b = 0; b < nblocks; b++) {
+    long start = block_r[b]*width, end = block_r[b+1]*width, i, count = 0;
+    for (i = start; i < end; i++) if (parent[i] == i) count++;
+    block_roots[b+1] = count;
+  }
+  for (b = 0; b < nblocks; b++) block_roots[b+1] += block_roots[b];
+  #pragma omp parallel for schedule(static,1)
+  for (b = 0; b < nblocks; b++) {
+    long start = block_r[b]*width, end = block_r[b+1]*width, i, id = block_roots[b];
+    for (i = start; i < end; i++) if (parent[i] == i) dst_data[i] = ++id;
+  }
+
+  // (5) label all voxels
+  #pragma omp parallel for schedule(static,1)
+  for (b = 0; b < nblocks; b++) {
+    long start = block_r[b]*width, end = block_r[b+1]*width, i;
+    for (i = start; i < end; i++) {
+      if (parent[i] != i) dst_data[i] = dst_data[parent[i]];
+    }
+  }
+  long ncomps = block_roots[nblocks];
+
+  // cleanup
+  free(parent);
+  free(linked);
+  free(block_r);
+  free(block_roots);
+
+  return ncomps;
+}
+
+/***********************************************************
+ * instantiations
+ ***********************************************************/
+
+#define VIDEOGRAPH_INSTANTIATE(real)                                    \
+  template int graph<real, real>(real *, const real *, const Video &, int, char); \
+  template int graph<real, unsigned char>(real *, const unsigned char *, const Video &, int, char); \
+  template int appendgraph<real, real>(real *, const real *, const Video &, long, int, char); \
+  template int appendgraph<real, unsigned char>(real *, const unsigned char *, const Video &, long, int, char); \
+  template int flowgraph<real, real>(real *, const real *, const Video &, const real *, char); \
+  template int flowgraph<real, unsigned char>(real *, const unsigned char *, const Video &, const real *, char); \
+  template long segmentmst<real>(real *, const real *, const Volume &, long, real, int, bool); \
+  template int savegraph<real>(const char *, const real *, const Volume &, long, char, int); \
+  template long segmentcached<real>(real *, const GraphFile &, real, int, bool); \
+  template int colorize<real>(real *, const real *, const Volume &, real *, long, long, unsigned int *); \
+  template long densemap<real>(const real *, long, long **); \
+  template long adjacency<real>(const real *, const Volume &, long **); \
+  template long componentstats<real>(const real *, const Volume &, real **); \
+  template int poolcomponents<real>(real *, real *, real *, const long *, long, \
+                                    const real *, const Video &, int, real, real); \
+  template long connectedcomponents<real>(real *, const real *, const Volume &, int); \
+  template long segmentmst<real>(Runs *, const real *, const Volume &, long, real, int, bool); \
+  template long segmentcached<real>(Runs *, const GraphFile &, real, int, bool); \
+  template long encoderuns<real>(Runs *, const real *, const Volume &); \
+  template int decoderuns<real>(real *, const Runs &); \
+  template int colorize<real>(real *, const Runs &, real *, long, long, unsigned int *); \
+  template long componentstats<real>(const Runs &, real **);
+
+VIDEOGRAPH_INSTANTIATE(float)
+VIDEOGRAPH_INSTANTIATE(double)
+
+}
@@ -0,0 +1,213 @@
+#ifndef _VIDEOGRAPH_CORE_
+#define _VIDEOGRAPH_CORE_
+
+/*
+  videograph core: all the graph/segmentation kernels, over raw
+  buffers and dimensions, independent of Lua and Torch.
+
+  All functions are re-entrant: they keep no global state, and can
+  be called concurrently from any number of threads (on distinct
+  outputs). Buffers returned through a pointer argument are
+  allocated with malloc(), and must be released with free().
+
+  Functions returning an int return OK (0) on success, and a negative
+  status code on error; functions returning a count (long) return
+  a negative status code on error. See errorstring().
+
+  Layouts:
+    video   : LxKxHxW (or LxHxW, K=1), any strides (see Video)
+    graph   : LxPxHxW contiguous, one plane per edge of the stencil:
+              P = 3 (6-connex), 4 (CONNEX_6T2: 6-connex + t+2), 5
+              (8-connex in space + t), 9 (18-connex) or 13 (26-connex);
+              see stencil.h for the offset of each plane
+    labels  : LxHxW contiguous, non-negative component ids,
+              or run-length encoded (see Runs)
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace videograph {
+
+// status codes
+enum {
+  OK = 0,
+  ERROR_DIMS = -1,     // inconsistent or unsupported dimensions
+  ERROR_CONNEX = -2,   // unsupported connexity
+  ERROR_ARG = -3,      // invalid argument
+  ERROR_MEMORY = -4,   // allocation failed
+  ERROR_IO = -5,       // file cannot be read or written
+  ERROR_FORMAT = -6    // file is not a valid graph file
+};
+
+const char *errorstring(int status);
+
+// geometry of a video: dims, and strides (in elements), so that
+// strided views (and any element type) can be read in place
+struct Video {
+  long length, channels, height, width;
+  long sz, sk, sy, sx;
+};
+
+// geometry of a (contiguous) label volume
+struct Volume {
+  long length, height, width;
+};
+
+// run-length encoded label volume: each of the L*H rows (z,y) is a
+// sequence of runs along x, each run being (end, id), where end is
+// the (exclusive) x where the run stops: the runs of a row start at
+// x = 0, and the last one ends at W. Both arrays are malloc()ed by
+// the functions producing runs, and must be released with free().
+struct Runs {
+  Volume vol;
+  long nruns;
+  long *rows;              // L*H+1: the runs of row r are [rows[r], rows[r+1])
+  int32_t *runs;           // nruns x 2: (end, id)
+};
+
+// size of a component's statistics record (see componentstats)
+enum { STATS_SIZE = 18 };
+
+// connexities: 6 (x, y, t), 8 (8-connexity in space, plus t), 18 and
+// 26 (3x3x3 cube) are numbers of neighbors; the stencil that adds a
+// second temporal link (t+2) to 6-connexity has a code of its own
+enum { CONNEX_6T2 = 106 };
+
+// number of graph planes P for a connexity (6, CONNEX_6T2, 8, 18, 26),
+// and connexity for a number of planes
+int stencilplanes(int connex);
+int stencilconnex(long nmaps);
+
+// computes an edge-weighted graph on a video: dst must hold
+// L*P*H*W elements (P = stencilplanes(connex));
+// dt is the distance: 'e' (euclid), 'a' (angle), 'm' (max)
+template <typename real, typename T>
+int graph(real *dst, const T *src, const Video &v, int connex, char dt);
+
+// same, only weighting the edges that end in frames [overlap,L): the
+// edges among the first overlap frames (already weighted, in the
+// graph of a previous chunk) are left to 0; graph() is overlap = 0
+template <typename real, typename T>
+int appendgraph(real *dst, const T *src, const Video &v, long overlap, int connex, char dt);
+
+// same, with time edges warped by a (contiguous) Lx2xHxW flow field;
+// only 6-connexity is supported
+template <typename real, typename T>
+int flowgraph(real *dst, const T *src, const Video &v, const real *flow, char dt);
+
+// segments a graph (LxPxHxW) by thresholding its min-spanning tree;
+// labels (L*H*W) receives the root voxel index of each component;
+// returns the number of components
+template <typename real>
+long segmentmst(real *labels, const real *graph, const Volume &vol, long nmaps,
+                real thres, int minsize, bool adaptive);
+
+// graph files: the sorted edge list of a graph, so that it can be
+// segmented many times (with different parameters) without being
+// rebuilt or sorted. Layout (native byte order):
+//   header  : magic, version, connexity, quantization (bits per
+//             weight: 0 = float, 8 or 16), L, H, W, number of edges E,
+//             dequantization (w = wmin + code*wstep), distance
+//   a, b    : 2 x E int32, the voxel indices of each edge's ends
+//   weights : E float/uint8/uint16, in non-decreasing order
+// Files are memory-mapped: opening one only checks its header (edge
+// ends are checked as segmentations read them).
+enum { GRAPHFILE_VERSION = 2 };
+
+struct GraphFile {
+  Volume vol;
+  int connex;              // stencil of the graph (see stencilplanes)
+  char dt;                 // distance: 'e' | 'a' | 'm'
+  int quant;               // 0 (float weights), 8 or 16 bits
+  long nedges;
+  const int32_t *a, *b;    // edge ends (voxel indices)
+  const void *weights;     // weights, or quantized codes
+  float wmin, wstep;       // dequantization
+  void *map;               // mapping (NULL once closed)
+  size_t mapsize;
+};
+
+// writes the sorted edges of a graph (LxPxHxW) to a graph file;
+// dt is recorded as the graph's distance
+template <typename real>
+int savegraph(const char *path, const real *graph, const Volume &vol, long nmaps,
+              char dt, int quant);
+
+// maps a graph file (read-only), and checks its header; the mapping
+// must be released with closegraph()
+int opengraph(const char *path, GraphFile *graph);
+void closegraph(GraphFile *graph);
+
+// same as segmentmst, starting from the sorted edges of a graph file
+// (labels must hold L*H*W elements, see graph.vol); returns
+// ERROR_FORMAT if an edge end is out of the volume
+template <typename real>
+long segmentcached(real *labels, const GraphFile &graph, real thres, int minsize, bool adaptive);
+
+// same as segmentmst, and segmentcached, producing runs (no dense
+// label volume is ever allocated)
+template <typename real>
+long segmentmst(Runs *labels, const real *graph, const Volume &vol, long nmaps,
+                real thres, int minsize, bool adaptive);
+template <typename real>
+long segmentcached(Runs *labels, const GraphFile &graph, real thres, int minsize, bool adaptive);
+
+// converts a label volume to runs (ids must be integers < 2^31), and
+// back; encoderuns returns the number of runs
+template <typename real>
+long encoderuns(Runs *runs, const real *labels, const Volume &vol);
+template <typename real>
+int decoderuns(real *labels, const Runs &runs);
+
+// colorizes a label volume into dst (LxCxHxW), using colormap (NxC):
+// rows whose first entry is -1 are filled with random colors,
+// drawn from seed (rand_r)
+template <typename real>
+int colorize(real *dst, const real *labels, const Volume &vol,
+             real *colormap, long ncolors, long channels, unsigned int *seed);
+template <typename real>
+int colorize(real *dst, const Runs &labels,
+             real *colormap, long ncolors, long channels, unsigned int *seed);
+
+// maps component ids to dense indices 0..N-1, in increasing id order:
+// index (n entries) receives the dense index of each label (memory
+// is O(n), whatever the range of ids); returns N
+template <typename real>
+long densemap(const real *labels, long n, long **index);
+
+// lists the pairs of adjacent components (6-connexity): pairs holds
+// 2*npairs ids, each pair as (a,b) with a < b, sorted and unique;
+// returns npairs
+template <typename real>
+long adjacency(const real *labels, const Volume &vol, long **pairs);
+long adjacency(const Runs &labels, long **pairs);
+
+// computes the statistics of each component: stats holds N records
+// of STATS_SIZE entries, in dense index order (see segm2components
+// for the layout of a record); returns N. On runs, colorize,
+// adjacency and componentstats do their work per run, not per voxel
+template <typename real>
+long componentstats(const real *labels, const Volume &vol, real **stats);
+template <typename real>
+long componentstats(const Runs &labels, real **stats);
+
+// pools features (LxKxHxW, any strides) over components, given the
+// dense index of each voxel (see densemap): mean and max are NxK, hist
+// is NxKxB (can be NULL if nbins == 0), with bins spanning [hmin,hmax]
+// (values outside fall in the first or last bin, NaNs in none); a NaN
+// hmin or hmax is replaced by the min or max of the features
+template <typename real>
+int poolcomponents(real *mean, real *max, real *hist,
+                   const long *index, long ncomps,
+                   const real *feats, const Video &v,
+                   int nbins, real hmin, real hmax);
+
+// relabels a label volume into connected components (any connexity,
+// see stencilplanes), with compact ids 1..N in raster order; returns N
+template <typename real>
+long connectedcomponents(real *dst, const real *labels, const Volume &vol, int connex);
+
+}
+
+#endif
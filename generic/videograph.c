@@ -2,227 +2,159 @@
 #define TH_GENERIC_FILE "generic/videograph.c"
 #else
 
-#ifdef square
-#undef square
-#endif
-#define square(x) ((x)*(x))
+/*
+  Lua bindings: arguments are read from the Lua stack, tensors are
+  mapped to raw buffers, and all the work is done by the core library
+  (core/videograph.h), which is independent of Lua.
+*/
+
+#ifndef _VIDEOGRAPH_BINDINGS_
+#define _VIDEOGRAPH_BINDINGS_
+// raises a Lua error if a core function failed
+#define videograph_check(status, name)                                  \
+  if ((status) < 0) THError("<videograph." name "> %s", videograph::errorstring(status))
+
+// geometry of an input video, read from its dims and strides
+template <typename Tensor>
+static void video_geometry(videograph::Video *v, Tensor *src) {
+  v->length = 1; v->channels = 1; v->height = 1; v->width = 1;
+  v->sz = 0; v->sk = 0; v->sy = 0; v->sx = 0;
+  if (src->nDimension == 4) {
+    v->length = src->size[0];   v->sz = src->stride[0];
+    v->channels = src->size[1]; v->sk = src->stride[1];
+    v->height = src->size[2];   v->sy = src->stride[2];
+    v->width = src->size[3];    v->sx = src->stride[3];
+  } else if (src->nDimension == 3) {
+    v->length = src->size[0];   v->sz = src->stride[0];
+    v->height = src->size[1];   v->sy = src->stride[1];
+    v->width = src->size[2];    v->sx = src->stride[2];
+  } else {
+    THError("<videograph> input must be LxKxHxW or LxHxW");
+  }
+}
 
-#ifdef min
-#undef min
-#endif
-#define min(x,y) (x)<(y) ? (x) : (y)
+// the raw frames at index, when the video is not of the type of the
+// output (named by of): any type other than Byte is an error
+static THByteTensor *video_bytes(lua_State *L, int index, const char *name, const char *of) {
+  THByteTensor *bsrc = (THByteTensor *)luaT_toudata(L, index, "torch.ByteTensor");
+  if (!bsrc) THError("<videograph.%s> video must be Byte or the same type as %s", name, of);
+  return bsrc;
+}
 
-#ifdef max
-#undef max
-#endif
-#define max(x,y) (x)>(y) ? (x) : (y)
+// geometry of a label volume
+template <typename Tensor>
+static void volume_geometry(videograph::Volume *vol, Tensor *segm, const char *name) {
+  if (segm->nDimension != 3)
+    THError("<videograph.%s> segm must be LxHxW", name);
+  vol->length = segm->size[0];
+  vol->height = segm->size[1];
+  vol->width = segm->size[2];
+}
 
-#ifdef rand0to1
-#undef rand0to1
-#endif
-#define rand0to1() ((float)rand()/(float)RAND_MAX)
+// run-length encoded labels: rows (LongTensor, L*H+1) and runs
+// (IntTensor, nruns x 2), both contiguous
+static void runs_geometry(videograph::Runs *r, lua_State *L, int index, const char *name) {
+  THLongTensor *rows = (THLongTensor *)luaT_checkudata(L, index, "torch.LongTensor");
+  THIntTensor *runs = (THIntTensor *)luaT_checkudata(L, index+1, "torch.IntTensor");
+  r->vol.length = lua_tonumber(L, index+2);
+  r->vol.height = lua_tonumber(L, index+3);
+  r->vol.width = lua_tonumber(L, index+4);
+  if (!THLongTensor_isContiguous(rows) || !THIntTensor_isContiguous(runs)
+      || THLongTensor_nElement(rows) != r->vol.length*r->vol.height+1
+      || runs->nDimension != 2 || runs->size[1] != 2)
+    THError("<videograph.%s> runs must be contiguous, with L*H+1 rows and Nx2 runs", name);
+  r->nruns = runs->size[0];
+  r->rows = THLongTensor_data(rows);
+  r->runs = (int32_t *)THIntTensor_data(runs);
+}
 
-#ifdef epsilon
-#undef epsilon
-#endif
-#define epsilon 1e-8
-
-static inline real videograph_(ndiff)(real *img,
-                                   int nfeats, int height, int width,
-                                   int x1, int y1, int z1, int x2, int y2, int z2, char dt) {
-  real dist  = 0;
-  real dot   = 0;
-  real normx = 0;
-  real normy = 0;
-  real res = 0;
-  int i;
-  for (i=0; i<nfeats; i++) {
-    if (dt == 'e') {
-      dist  += square( img[((z1*nfeats+i)*height+y1)*width+x1] - img[((z2*nfeats+i)*height+y2)*width+x2] );
-    } else if (dt == 'm') {
-      real tmp = fabs( img[((z1*nfeats+i)*height+y1)*width+x1] - img[((z2*nfeats+i)*height+y2)*width+x2] );
-      if (tmp > dist) {
-        dist = tmp;
-      }
-    } else if (dt == 'a') {
-      dot   += img[((z1*nfeats+i)*height+y1)*width+x1] * img[((z2*nfeats+i)*height+y2)*width+x2];
-      normx += square(img[((z1*nfeats+i)*height+y1)*width+x1]);
-      normy += square(img[((z2*nfeats+i)*height+y2)*width+x2]);
-    }
+// hands runs produced by the core over to rows and runs (no copy)
+static void runs_export(videograph::Runs *r, THLongTensor *rows, THIntTensor *runs) {
+  long nrows = r->vol.length*r->vol.height+1;
+  THLongStorage *rowstorage = THLongStorage_newWithData(r->rows, nrows);
+  THIntStorage *runstorage = THIntStorage_newWithData((int *)r->runs, 2*r->nruns);
+  THLongTensor_setStorage1d(rows, rowstorage, 0, nrows, 1);
+  THIntTensor_setStorage2d(runs, runstorage, 0, r->nruns, 2, 2, 1);
+  THLongStorage_free(rowstorage);
+  THIntStorage_free(runstorage);
+}
+
+// graph files: mapped on creation, unmapped when collected
+static int videograph_GraphFile_new(lua_State *L) {
+  const char *path = luaL_checkstring(L, 1);
+  videograph::GraphFile *graph = (videograph::GraphFile *)malloc(sizeof(videograph::GraphFile));
+  int status = videograph::opengraph(path, graph);
+  if (status < 0) {
+    free(graph);
+    THError("<videograph.loadgraph> %s: %s", path, videograph::errorstring(status));
   }
-  if (dt == 'e') res = sqrt(dist);
-  else if (dt == 'a') res = acos(dot/(sqrt(normx)*sqrt(normy) + epsilon));
-  else if (dt == 'm') res = dist;
-  return res;
+  luaT_pushudata(L, graph, "videograph.GraphFile");
+  return 1;
 }
 
+static int videograph_GraphFile_free(lua_State *L) {
+  videograph::GraphFile *graph = (videograph::GraphFile *)luaT_checkudata(L, 1, "videograph.GraphFile");
+  videograph::closegraph(graph);
+  free(graph);
+  return 0;
+}
+
+static int videograph_GraphFile_info(lua_State *L) {
+  videograph::GraphFile *graph = (videograph::GraphFile *)luaT_checkudata(L, 1, "videograph.GraphFile");
+  const char *dist = (graph->dt == 'a') ? "angle" : (graph->dt == 'm') ? "max" : "euclid";
+  lua_newtable(L);
+  lua_pushnumber(L, graph->vol.length); lua_setfield(L, -2, "length");
+  lua_pushnumber(L, graph->vol.height); lua_setfield(L, -2, "height");
+  lua_pushnumber(L, graph->vol.width); lua_setfield(L, -2, "width");
+  if (graph->connex == videograph::CONNEX_6T2) lua_pushstring(L, "6t2");
+  else lua_pushnumber(L, graph->connex);
+  lua_setfield(L, -2, "connex");
+  lua_pushstring(L, dist); lua_setfield(L, -2, "distance");
+  lua_pushnumber(L, graph->quant); lua_setfield(L, -2, "quant");
+  lua_pushnumber(L, graph->nedges); lua_setfield(L, -2, "nedges");
+  return 1;
+}
+
+static const struct luaL_Reg videograph_GraphFile__ [] = {
+  {"info", videograph_GraphFile_info},
+  {NULL, NULL}
+};
+
+static void videograph_GraphFileInit(lua_State *L) {
+  luaT_newmetatable(L, "videograph.GraphFile", NULL,
+                    videograph_GraphFile_new, videograph_GraphFile_free, NULL);
+  luaL_register(L, NULL, videograph_GraphFile__);
+  lua_pop(L,1);
+}
+#endif
+
 static int videograph_(graph)(lua_State *L) {
-  // get args
+  // get args: the input can be any strided view, either of
+  // the same type as the graph, or a ByteTensor (raw frames)
   THTensor *dst = (THTensor *)luaT_checkudata(L, 1, torch_Tensor);
-  THTensor *src = (THTensor *)luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *src = (THTensor *)luaT_toudata(L, 2, torch_Tensor);
+  THByteTensor *bsrc = NULL;
+  if (!src) bsrc = video_bytes(L, 2, "graph", "dest");
   int connex = lua_tonumber(L, 3);
   const char *dist = lua_tostring(L, 4);
   char dt = dist[0];
 
-  // make sure input is contiguous
-  src = THTensor_(newContiguous)(src);
-
-  // compute all edge weights
-  if (connex == 6) {
-
-    // get input dims
-    long length=1, channels=1, height=1, width=1;
-    if (src->nDimension == 4) {
-      length = src->size[0];
-      channels = src->size[1];
-      height = src->size[2];
-      width = src->size[3];
-    } else if (src->nDimension == 3) {
-      channels = 1;
-      length = src->size[0];
-      height = src->size[1];
-      width = src->size[2];
-    }
-
-    // resize output, and fill it with -1 (which means non-valid edge)
-    THTensor_(resize4d)(dst, length, 3, height, width);
-    THTensor_(fill)(dst, 0);
-
-    // get raw pointers
-    real *src_data = THTensor_(data)(src);
-    real *dst_data = THTensor_(data)(dst);
-
-    // build graph with 6-connexity
-    long num = 0;
-    long x,y,z;
-    for (z = 0; z < length; z++) {
-      for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-          if (x < width-1) {
-            dst_data[((z*3+0)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x+1, y, z, dt);
-            num++;
-          }
-          if (y < height-1) {
-            dst_data[((z*3+1)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x, y+1, z, dt);
-            num++;
-          }
-          if (z < length-1) {
-            dst_data[((z*3+2)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x, y, z+1, dt);
-            num++;
-          }
-        }
-      }
-    }
-
-  } if (connex == 26) {
-
-    // get input dims
-    long length=1, channels=1, height=1, width=1;
-    if (src->nDimension == 4) {
-      length = src->size[0];
-      channels = src->size[1];
-      height = src->size[2];
-      width = src->size[3];
-    } else if (src->nDimension == 3) {
-      channels = 1;
-      length = src->size[0];
-      height = src->size[1];
-      width = src->size[2];
-    }
-
-    // resize output, and fill it with -1 (which means non-valid edge)
-    THTensor_(resize4d)(dst, length, 13, height, width);
-    THTensor_(fill)(dst, 0);
-
-    // get raw pointers
-    real *src_data = THTensor_(data)(src);
-    real *dst_data = THTensor_(data)(dst);
-
-    // build graph with 26-connexity
-    long num = 0;
-    long x,y,z;
-    for (z = 0; z < length; z++) {
-      for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-          if (x < width-1) {
-            dst_data[((z*13+0)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x+1, y, z, dt);
-            num++;
-          }
-          if (y < height-1) {
-            dst_data[((z*13+1)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x, y+1, z, dt);
-            num++;
-          }
-          if ((x < width-1) && (y < height-1)) {
-            dst_data[((z*13+2)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x+1, y+1, z, dt);
-            num++;
-          }
-          if ((x < width-1) && (y > 0)) {
-            dst_data[((z*13+3)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x+1, y-1, z, dt);
-            num++;
-          }
-          if (z < length-1) {
-            dst_data[((z*13+4)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x, y, z+1, dt);
-            num++;
-
-            if (x < width-1) {
-              dst_data[((z*13+5)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                             x, y, z, x+1, y, z+1, dt);
-              num++;
-            }
-            if (y < height-1) {
-              dst_data[((z*13+6)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                             x, y, z, x, y+1, z+1, dt);
-              num++;
-            }
-            if ((x < width-1) && (y < height-1)) {
-              dst_data[((z*13+7)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                             x, y, z, x+1, y+1, z+1, dt);
-              num++;
-            }
-            if ((x < width-1) && (y > 0)) {
-              dst_data[((z*13+8)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                             x, y, z, x+1, y-1, z+1, dt);
-              num++;
-            }
-
-            if (x > 0) {
-              dst_data[((z*13+9)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                             x, y, z, x-1, y, z+1, dt);
-              num++;
-            }
-            if (y > 0) {
-              dst_data[((z*13+10)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                             x, y, z, x, y-1, z+1, dt);
-              num++;
-            }
-            if ((x > 0) && (y > 0)) {
-              dst_data[((z*13+11)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                             x, y, z, x-1, y-1, z+1, dt);
-              num++;
-            }
-            if ((y < height-1) && (x > 0)) {
-              dst_data[((z*13+12)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                             x, y, z, x-1, y+1, z+1, dt);
-              num++;
-            }
-
-          }
-        }
-      }
-    }
+  // get input geometry (no copy is made, strides are used as is)
+  videograph::Video v;
+  if (src) video_geometry(&v, src);
+  else video_geometry(&v, bsrc);
 
-  }
+  // resize output: one plane per edge of the stencil
+  int nmaps = videograph::stencilplanes(connex);
+  if (nmaps < 0) THError("<videograph.graph> connexity must be 6, 8, 18, 26 or '6t2'");
+  THTensor_(resize4d)(dst, v.length, nmaps, v.height, v.width);
+  real *dst_data = THTensor_(data)(dst);
 
-  // cleanup
-  THTensor_(free)(src);
+  // compute all edge weights
+  int status;
+  if (src) status = videograph::graph(dst_data, (const real *)THTensor_(data)(src), v, connex, dt);
+  else status = videograph::graph(dst_data, (const unsigned char *)THByteTensor_data(bsrc), v, connex, dt);
+  videograph_check(status, "graph");
 
   return 0;
 }
@@ -230,113 +162,56 @@ static int videograph_(graph)(lua_State *L) {
 static int videograph_(flowgraph)(lua_State *L) {
   // get args
   THTensor *dst = (THTensor *)luaT_checkudata(L, 1, torch_Tensor);
-  THTensor *src = (THTensor *)luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *src = (THTensor *)luaT_toudata(L, 2, torch_Tensor);
+  THByteTensor *bsrc = NULL;
+  if (!src) bsrc = video_bytes(L, 2, "flowgraph", "dest");
   THTensor *flow = (THTensor *)luaT_checkudata(L, 3, torch_Tensor);
   int connex = lua_tonumber(L, 4);
   const char *dist = lua_tostring(L, 5);
   char dt = dist[0];
 
-  // make sure input is contiguous
-  src = THTensor_(newContiguous)(src);
+  // only 6-connexity is supported with a flow field
+  if (connex != 6)
+    THError("<videograph.flowgraph> connexity must be 6");
 
-  // compute all edge weights
-  if (connex == 6) {
-
-    // get input dims
-    long length=1, channels=1, height=1, width=1;
-    if (src->nDimension == 4) {
-      length = src->size[0];
-      channels = src->size[1];
-      height = src->size[2];
-      width = src->size[3];
-    } else if (src->nDimension == 3) {
-      channels = 1;
-      length = src->size[0];
-      height = src->size[1];
-      width = src->size[2];
-    }
-
-    // resize output, and fill it with -1 (which means non-valid edge)
-    THTensor_(resize4d)(dst, length, 3, height, width);
-    THTensor_(fill)(dst, 0);
-
-    // get raw pointers
-    real *src_data = THTensor_(data)(src);
-    real *dst_data = THTensor_(data)(dst);
-    real *flow_data = THTensor_(data)(flow);
-
-    // build graph with 6-connexity
-    long num = 0;
-    long x,y,z;
-    for (z = 0; z < length; z++) {
-      for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-          // spatial x/y edges
-          if (x < width-1) {
-            dst_data[((z*3+0)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x+1, y, z, dt);
-            num++;
-          }
-          if (y < height-1) {
-            dst_data[((z*3+1)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                           x, y, z, x, y+1, z, dt);
-            num++;
-          }
-          // time edges (flow-dependent)
-          if (z < length-1) {
-            real ox = flow_data[(((z+1)*2+0)*height+y)*width+x];
-            real oy = flow_data[(((z+1)*2+1)*height+y)*width+x];
-            long fx = floor(x+ox+0.5);
-            long fy = floor(y+oy+0.5);
-            if (fx >= 0 && fy >= 0 && fx < width && fy < height) {
-              dst_data[((z*3+2)*height+y)*width+x] = videograph_(ndiff)(src_data, channels, height, width,
-                                                                        fx, fy, z, x, y, z+1, dt);
-              num++;
-            }
-          }
-        }
-      }
-    }
+  // get input geometry (no copy is made, strides are used as is)
+  videograph::Video v;
+  if (src) video_geometry(&v, src);
+  else video_geometry(&v, bsrc);
 
-  }
+  // resize output
+  THTensor_(resize4d)(dst, v.length, 3, v.height, v.width);
+  real *dst_data = THTensor_(data)(dst);
+
+  // the flow field is small compared to the video: make it contiguous
+  flow = THTensor_(newContiguous)(flow);
+  real *flow_data = THTensor_(data)(flow);
+
+  // compute all edge weights
+  int status;
+  if (src) status = videograph::flowgraph(dst_data, (const real *)THTensor_(data)(src), v, flow_data, dt);
+  else status = videograph::flowgraph(dst_data, (const unsigned char *)THByteTensor_data(bsrc), v, flow_data, dt);
 
   // cleanup
-  THTensor_(free)(src);
+  THTensor_(free)(flow);
+  videograph_check(status, "flowgraph");
 
   return 0;
 }
 
-#ifndef _EDGE_STRUCT_
-#define _EDGE_STRUCT_
-typedef struct {
-  float w;
-  int a, b;
-} Edge;
-
-void sort_edges(Edge *data, int N)
-{
-  int i, j;
-  real v;
-  Edge t;
-
-  if(N<=1) return;
-
-  // Partition elements
-  v = data[0].w;
-  i = 0;
-  j = N;
-  for(;;)
-    {
-      while(data[++i].w < v && i < N) { }
-      while(data[--j].w > v) { }
-      if(i >= j) break;
-      t = data[i]; data[i] = data[j]; data[j] = t;
-    }
-  t = data[i-1]; data[i-1] = data[0]; data[0] = t;
-  sort_edges(data, i-1);
-  sort_edges(data+i, N-i);
+// replaces labels by random colors into dst (Lx3xHxW); frees labels
+static void videograph_(randomcolors)(THTensor *dst, THTensor *labels, const videograph::Volume &vol) {
+  long n = vol.length*vol.height*vol.width;
+  THTensor *colormap = THTensor_(newWithSize2d)(n, 3);
+  THTensor_(fill)(colormap, -1);
+  THTensor_(resize4d)(dst, vol.length, 3, vol.height, vol.width);
+  unsigned int seed = rand();
+  int status = videograph::colorize(THTensor_(data)(dst), (const real *)THTensor_(data)(labels), vol,
+                                    THTensor_(data)(colormap), n, 3, &seed);
+  THTensor_(free)(colormap);
+  THTensor_(free)(labels);
+  videograph_check(status, "segmentmst");
 }
-#endif
 
 static int videograph_(segmentmst)(lua_State *L) {
   // get args
@@ -348,212 +223,149 @@ static int videograph_(segmentmst)(lua_State *L) {
   int color = lua_toboolean(L, 6);
 
   // dims
-  long length = src->size[0];
+  if (src->nDimension != 4)
+    THError("<videograph.segmentmst> graph must be LxKxHxW");
+  videograph::Volume vol;
+  vol.length = src->size[0];
+  vol.height = src->size[2];
+  vol.width = src->size[3];
   long nmaps = src->size[1];
-  long height = src->size[2];
-  long width = src->size[3];
 
   // make sure input is contiguous
   src = THTensor_(newContiguous)(src);
   real *src_data = THTensor_(data)(src);
 
-  // create edge list from graph (src)
-  Edge *edges = NULL; int nedges = 0;
-  edges = (Edge *)calloc(length*width*height*nmaps, sizeof(Edge));
-  int x,y,z;
-  for (z = 0; z < length; z++) {
-    for (y = 0; y < height; y++) {
-      for (x = 0; x < width; x++) {
-        if (nmaps == 3) { 
-          // 6-connexity
-          if (x < width-1) {
-            edges[nedges].a = (z*height+y)*width+x;
-            edges[nedges].b = (z*height+y)*width+(x+1);
-            edges[nedges].w = src_data[((z*3+0)*height+y)*width+x];
-            nedges++;
-          }
-          if (y < height-1) {
-            edges[nedges].a = (z*height+y)*width+x;
-            edges[nedges].b = (z*height+(y+1))*width+x;
-            edges[nedges].w = src_data[((z*3+1)*height+y)*width+x];
-            nedges++;
-          }
-          if (z < length-1) {
-            edges[nedges].a = (z*height+y)*width+x;
-            edges[nedges].b = ((z+1)*height+y)*width+x;
-            edges[nedges].w = src_data[((z*3+2)*height+y)*width+x];
-            nedges++;
-          }
-        } else if (nmaps == 13) {
-          // 26-connexity
-          if (x < width-1) {
-            edges[nedges].a = (z*height+y)*width+x;
-            edges[nedges].b = (z*height+y)*width+(x+1);
-            edges[nedges].w = src_data[((z*13+0)*height+y)*width+x];
-            nedges++;
-          }
-          if (y < height-1) {
-            edges[nedges].a = (z*height+y)*width+x;
-            edges[nedges].b = (z*height+(y+1))*width+x;
-            edges[nedges].w = src_data[((z*13+1)*height+y)*width+x];
-            nedges++;
-          }
-          if ((x < width-1) && (y < height-1)) {
-            edges[nedges].a = (z*height+y) * width + x;
-            edges[nedges].b = (z*height+(y+1)) * width + (x+1);
-            edges[nedges].w = src_data[((z*13+2)*height+y)*width+x];
-            nedges++;
-          }
-          if ((x < width-1) && (y > 0)) {
-            edges[nedges].a = (z*height+y) * width + x;
-            edges[nedges].b = (z*height+(y-1)) * width + (x+1);
-            edges[nedges].w = src_data[((z*13+3)*height+y)*width+x];
-            nedges++;
-          }
-          if (z < length-1) {
-            edges[nedges].a = (z*height+y)*width+x;
-            edges[nedges].b = ((z+1)*height+y)*width+x;
-            edges[nedges].w = src_data[((z*13+4)*height+y)*width+x];
-            nedges++;
-
-            if (x < width-1) {
-              edges[nedges].a = (z*height+y)*width+x;
-              edges[nedges].b = ((z+1)*height+y)*width+(x+1);
-              edges[nedges].w = src_data[((z*13+5)*height+y)*width+x];
-              nedges++;
-            }
-            if (y < height-1) {
-              edges[nedges].a = (z*height+y)*width+x;
-              edges[nedges].b = ((z+1)*height+(y+1))*width+x;
-              edges[nedges].w = src_data[((z*13+6)*height+y)*width+x];
-              nedges++;
-            }
-            if ((x < width-1) && (y < height-1)) {
-              edges[nedges].a = (z*height+y) * width + x;
-              edges[nedges].b = ((z+1)*height+(y+1)) * width + (x+1);
-              edges[nedges].w = src_data[((z*13+7)*height+y)*width+x];
-              nedges++;
-            }
-            if ((x < width-1) && (y > 0)) {
-              edges[nedges].a = (z*height+y) * width + x;
-              edges[nedges].b = ((z+1)*height+(y-1)) * width + (x+1);
-              edges[nedges].w = src_data[((z*13+8)*height+y)*width+x];
-              nedges++;
-            }
-
-            if (x > 0) {
-              edges[nedges].a = (z*height+y)*width+x;
-              edges[nedges].b = ((z+1)*height+y)*width+(x-1);
-              edges[nedges].w = src_data[((z*13+9)*height+y)*width+x];
-              nedges++;
-            }
-            if (y > 0) {
-              edges[nedges].a = (z*height+y)*width+x;
-              edges[nedges].b = ((z+1)*height+(y-1))*width+x;
-              edges[nedges].w = src_data[((z*13+10)*height+y)*width+x];
-              nedges++;
-            }
-            if ((x > 0) && (y > 0)) {
-              edges[nedges].a = (z*height+y) * width + x;
-              edges[nedges].b = ((z+1)*height+(y-1)) * width + (x-1);
-              edges[nedges].w = src_data[((z*13+11)*height+y)*width+x];
-              nedges++;
-            }
-            if ((y < height-1) && (x > 0)) {
-              edges[nedges].a = (z*height+y) * width + x;
-              edges[nedges].b = ((z+1)*height+(y+1)) * width + (x-1);
-              edges[nedges].w = src_data[((z*13+12)*height+y)*width+x];
-              nedges++;
-            }
-
-          }
-        }
-      }
-    }
-  }
+  // segment
+  THTensor *labels = color ? THTensor_(new)() : dst;
+  THTensor_(resize3d)(labels, vol.length, vol.height, vol.width);
+  long nelts = videograph::segmentmst(THTensor_(data)(labels), (const real *)src_data, vol, nmaps,
+                                      thres, minsize, adaptivethres);
+  THTensor_(free)(src);
+  if (nelts < 0 && color) THTensor_(free)(labels);
+  videograph_check(nelts, "segmentmst");
 
-  // sort edges by weight
-  sort_edges(edges, nedges);
-
-  // make a disjoint-set forest
-  Set *set = set_new(width*height*length);
-
-  // init thresholds
-  real *threshold = (real *)calloc(width*height*length, sizeof(real));
-  int i;
-  for (i = 0; i < width*height*length; i++) threshold[i] = thres;
-
-  // for each edge, in non-decreasing weight order,
-  // decide to merge or not, depending on current threshold
-  for (i = 0; i < nedges; i++) {
-    // components conected by this edge
-    int a = set_find(set, edges[i].a);
-    int b = set_find(set, edges[i].b);
-    if (a != b) {
-      if ((edges[i].w <= threshold[a]) && (edges[i].w <= threshold[b])) {
-        set_join(set, a, b);
-        a = set_find(set, a);
-        if (adaptivethres) {
-          threshold[a] = edges[i].w + thres/set->elts[a].surface;
-        }
-      }
-    }
-  }
+  // generate output
+  if (color) videograph_(randomcolors)(dst, labels, vol);
 
-  // post process small components
-  for (i = 0; i < nedges; i++) {
-    int a = set_find(set, edges[i].a);
-    int b = set_find(set, edges[i].b);
-    if ((a != b) && ((set->elts[a].surface < minsize) || (set->elts[b].surface < minsize)))
-      set_join(set, a, b);
-  }
+  // push number of components
+  lua_pushnumber(L, nelts);
 
-  // generate output
-  if (color) {
-    THTensor *colormap = THTensor_(newWithSize2d)(width*height*length, 3);
-    THTensor_(fill)(colormap, -1);
-    THTensor_(resize4d)(dst, length, 3, height, width);
-    for (z = 0; z < length; z++) {
-      for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-          int comp = set_find(set, (z * height + y) * width + x);
-          real check = THTensor_(get2d)(colormap, comp, 0);
-          if (check == -1) {
-            THTensor_(set2d)(colormap, comp, 0, rand0to1());
-            THTensor_(set2d)(colormap, comp, 1, rand0to1());
-            THTensor_(set2d)(colormap, comp, 2, rand0to1());
-          }
-          real r = THTensor_(get2d)(colormap, comp, 0);
-          real g = THTensor_(get2d)(colormap, comp, 1);
-          real b = THTensor_(get2d)(colormap, comp, 2);
-          THTensor_(set4d)(dst, z, 0, y, x, r);
-          THTensor_(set4d)(dst, z, 1, y, x, g);
-          THTensor_(set4d)(dst, z, 2, y, x, b);
-        }
-      }
-    }
+  // return
+  return 1;
+}
+
+static int videograph_(segmentruns)(lua_State *L) {
+  // get args: the graph is a tensor, or a graph file
+  THLongTensor *rows = (THLongTensor *)luaT_checkudata(L, 1, "torch.LongTensor");
+  THIntTensor *runs = (THIntTensor *)luaT_checkudata(L, 2, "torch.IntTensor");
+  THTensor *src = (THTensor *)luaT_toudata(L, 3, torch_Tensor);
+  videograph::GraphFile *graph = NULL;
+  if (!src) graph = (videograph::GraphFile *)luaT_checkudata(L, 3, "videograph.GraphFile");
+  real thres = lua_tonumber(L, 4);
+  int minsize = lua_tonumber(L, 5);
+  int adaptivethres = lua_toboolean(L, 6);
+
+  // segment, straight into runs
+  videograph::Runs labels;
+  long nelts;
+  if (src) {
+    if (src->nDimension != 4)
+      THError("<videograph.segmentruns> graph must be LxKxHxW");
+    videograph::Volume vol;
+    vol.length = src->size[0];
+    vol.height = src->size[2];
+    vol.width = src->size[3];
+    src = THTensor_(newContiguous)(src);
+    nelts = videograph::segmentmst(&labels, (const real *)THTensor_(data)(src), vol, src->size[1],
+                                   thres, minsize, adaptivethres);
+    THTensor_(free)(src);
   } else {
-    THTensor_(resize3d)(dst, length, height, width);
-    real *dst_data = THTensor_(data)(dst);
-    for (z = 0; z < length; z++) {
-      for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-          dst_data[(z*height+y)*width+x] = set_find(set, (z * height + y) * width + x);
-        }
-      }
-    }
+    nelts = videograph::segmentcached(&labels, *graph, thres, minsize, adaptivethres);
   }
+  videograph_check(nelts, "segmentruns");
+  runs_export(&labels, rows, runs);
 
-  // push number of components
-  lua_pushnumber(L, set->nelts);
+  lua_pushnumber(L, nelts);
+  return 1;
+}
 
-  // cleanup
-  set_free(set);
-  free(edges);
-  free(threshold);
+static int videograph_(encoderuns)(lua_State *L) {
+  // get args
+  THLongTensor *rows = (THLongTensor *)luaT_checkudata(L, 1, "torch.LongTensor");
+  THIntTensor *runs = (THIntTensor *)luaT_checkudata(L, 2, "torch.IntTensor");
+  THTensor *segm = THTensor_(newContiguous)((THTensor *)luaT_checkudata(L, 3, torch_Tensor));
+  videograph::Volume vol;
+  volume_geometry(&vol, segm, "encoderuns");
+
+  // encode
+  videograph::Runs labels;
+  long nruns = videograph::encoderuns(&labels, (const real *)THTensor_(data)(segm), vol);
+  THTensor_(free)(segm);
+  videograph_check(nruns, "encoderuns");
+  runs_export(&labels, rows, runs);
+
+  lua_pushnumber(L, nruns);
+  return 1;
+}
+
+static int videograph_(decoderuns)(lua_State *L) {
+  // get args
+  THTensor *dst = (THTensor *)luaT_checkudata(L, 1, torch_Tensor);
+  videograph::Runs runs;
+  runs_geometry(&runs, L, 2, "decoderuns");
+
+  // decode
+  THTensor_(resize3d)(dst, runs.vol.length, runs.vol.height, runs.vol.width);
+  int status = videograph::decoderuns(THTensor_(data)(dst), runs);
+  videograph_check(status, "decoderuns");
+  return 0;
+}
+
+static int videograph_(savegraph)(lua_State *L) {
+  // get args
+  THTensor *src = (THTensor *)luaT_checkudata(L, 1, torch_Tensor);
+  const char *path = luaL_checkstring(L, 2);
+  char dt = lua_tostring(L, 3)[0];
+  int quant = lua_tonumber(L, 4);
+
+  // dims
+  if (src->nDimension != 4)
+    THError("<videograph.savegraph> graph must be LxKxHxW");
+  videograph::Volume vol;
+  vol.length = src->size[0];
+  vol.height = src->size[2];
+  vol.width = src->size[3];
+  long nmaps = src->size[1];
+
+  // sort edges, and write them
+  src = THTensor_(newContiguous)(src);
+  int status = videograph::savegraph(path, (const real *)THTensor_(data)(src), vol, nmaps, dt, quant);
   THTensor_(free)(src);
+  videograph_check(status, "savegraph");
+  return 0;
+}
 
-  // return
+static int videograph_(segmentcached)(lua_State *L) {
+  // get args
+  THTensor *dst = (THTensor *)luaT_checkudata(L, 1, torch_Tensor);
+  videograph::GraphFile *graph = (videograph::GraphFile *)luaT_checkudata(L, 2, "videograph.GraphFile");
+  real thres = lua_tonumber(L, 3);
+  int minsize = lua_tonumber(L, 4);
+  int adaptivethres = lua_toboolean(L, 5);
+  int color = lua_toboolean(L, 6);
+
+  // segment, straight from the mapped (sorted) edges
+  videograph::Volume vol = graph->vol;
+  THTensor *labels = color ? THTensor_(new)() : dst;
+  THTensor_(resize3d)(labels, vol.length, vol.height, vol.width);
+  long nelts = videograph::segmentcached(THTensor_(data)(labels), *graph, thres, minsize, adaptivethres);
+  if (nelts < 0 && color) THTensor_(free)(labels);
+  videograph_check(nelts, "segmentmst");
+
+  // generate output
+  if (color) videograph_(randomcolors)(dst, labels, vol);
+
+  lua_pushnumber(L, nelts);
   return 1;
 }
 
@@ -564,44 +376,59 @@ int videograph_(colorize)(lua_State *L) {
   THTensor *colormap = (THTensor *)luaT_checkudata(L, 3, torch_Tensor);
 
   // dims
-  long length = input->size[0];
-  long height = input->size[1];
-  long width = input->size[2];
+  videograph::Volume vol;
+  volume_geometry(&vol, input, "colorize");
 
   // generate color map if not given
   if (THTensor_(nElement)(colormap) == 0) {
-    THTensor_(resize2d)(colormap, width*height*length, 3);
+    THTensor_(resize2d)(colormap, vol.width*vol.height*vol.length, 3);
     THTensor_(fill)(colormap, -1);
   }
+  if (!THTensor_(isContiguous)(colormap))
+    THError("<videograph.colorize> colormap must be contiguous");
 
   // colormap channels
-  int channels = colormap->size[1];
+  long channels = colormap->size[1];
 
   // generate output
-  THTensor_(resize4d)(output, length, channels, height, width);
-  int x,y,k,z;
-  for (z = 0; z < length; z++) {  
-    for (y = 0; y < height; y++) {
-      for (x = 0; x < width; x++) {
-        int id = THTensor_(get3d)(input, z, y, x);
-        real check = THTensor_(get2d)(colormap, id, 0);
-        if (check == -1) {
-          for (k = 0; k < channels; k++) {
-            THTensor_(set2d)(colormap, id, k, rand0to1());
-          }
-        }
-        for (k = 0; k < channels; k++) {
-          real color = THTensor_(get2d)(colormap, id, k);
-          THTensor_(set4d)(output, z, k, y, x, color);
-        }
-      }
-    }
-  }
+  input = THTensor_(newContiguous)(input);
+  THTensor_(resize4d)(output, vol.length, channels, vol.height, vol.width);
+  unsigned int seed = rand();
+  int status = videograph::colorize(THTensor_(data)(output), (const real *)THTensor_(data)(input), vol,
+                                    THTensor_(data)(colormap), colormap->size[0], channels, &seed);
+  THTensor_(free)(input);
+  videograph_check(status, "colorize");
 
   // return nothing
   return 0;
 }
 
+int videograph_(colorizeruns)(lua_State *L) {
+  // get args
+  THTensor *output = (THTensor *)luaT_checkudata(L, 1, torch_Tensor);
+  videograph::Runs runs;
+  runs_geometry(&runs, L, 2, "colorize");
+  THTensor *colormap = (THTensor *)luaT_checkudata(L, 7, torch_Tensor);
+  videograph::Volume vol = runs.vol;
+
+  // generate color map if not given
+  if (THTensor_(nElement)(colormap) == 0) {
+    THTensor_(resize2d)(colormap, vol.width*vol.height*vol.length, 3);
+    THTensor_(fill)(colormap, -1);
+  }
+  if (!THTensor_(isContiguous)(colormap))
+    THError("<videograph.colorize> colormap must be contiguous");
+  long channels = colormap->size[1];
+
+  // generate output, run by run
+  THTensor_(resize4d)(output, vol.length, channels, vol.height, vol.width);
+  unsigned int seed = rand();
+  int status = videograph::colorize(THTensor_(data)(output), runs,
+                                    THTensor_(data)(colormap), colormap->size[0], channels, &seed);
+  videograph_check(status, "colorize");
+  return 0;
+}
+
 #ifndef __setneighbor__
 #define __setneighbor__
 static inline void setneighbor(lua_State *L, long matrix, long id, long idn) {
@@ -617,6 +444,14 @@ static inline void setneighbor(lua_State *L, long matrix, long id, long idn) {
   // write table back
   lua_rawseti(L, matrix, id);
 }
+
+static void setneighbors(lua_State *L, long matrix, const long *pairs, long npairs) {
+  long i;
+  for (i = 0; i < npairs; i++) {
+    setneighbor(L, matrix, pairs[2*i], pairs[2*i+1]);
+    setneighbor(L, matrix, pairs[2*i+1], pairs[2*i]);
+  }
+}
 #endif
 
 int videograph_(adjacency)(lua_State *L) {
@@ -625,161 +460,463 @@ int videograph_(adjacency)(lua_State *L) {
   long matrix = 2;
 
   // dims
-  long length = input->size[0];
-  long height = input->size[1];
-  long width = input->size[2];
+  videograph::Volume vol;
+  volume_geometry(&vol, input, "adjacency");
 
-  // raw pointers
-  real *input_data = THTensor_(data)(input);
+  // list adjacent pairs
+  long *pairs = NULL;
+  long npairs = videograph::adjacency((const real *)THTensor_(data)(input), vol, &pairs);
+  THTensor_(free)(input);
+  videograph_check(npairs, "adjacency");
 
   // generate output
-  int x,y,z;
-  for (z = 0; z < length; z++) {
-    for (y = 0; y < height; y++) {
-      for (x = 0; x < width; x++) {
-        long id = input_data[(height*z+y)*width+x];
-        if (x < (width-1)) {
-          long id_east = input_data[(height*z+y)*width+(x+1)];
-          if (id != id_east) {
-            setneighbor(L, matrix, id, id_east);
-            setneighbor(L, matrix, id_east, id);
-          }
-        }
-        if (y < (height-1)) {
-          long id_south = input_data[(height*z+(y+1))*width+x];
-          if (id != id_south) {
-            setneighbor(L, matrix, id, id_south);
-            setneighbor(L, matrix, id_south, id);
-          }
-        }
-        if (z < (length-1)) {
-          long id_next = input_data[(height*(z+1)+y)*width+x];
-          if (id != id_next) {
-            setneighbor(L, matrix, id, id_next);
-            setneighbor(L, matrix, id_next, id);
-          }
-        }
-      }
-    }
-  }
+  setneighbors(L, matrix, pairs, npairs);
 
   // cleanup
-  THTensor_(free)(input);
+  free(pairs);
 
   // return matrix
   return 1;
 }
 
-int videograph_(segm2components)(lua_State *L) {
+int videograph_(adjacencyruns)(lua_State *L) {
   // get args
-  THTensor *segm = (THTensor *)luaT_checkudata(L, 1, torch_Tensor);
-  real *segm_data = THTensor_(data)(segm);
+  videograph::Runs runs;
+  runs_geometry(&runs, L, 1, "adjacency");
+  long matrix = 6;
 
-  // check dims
-  if ((segm->nDimension != 3))
-    THError("<videograph.segm2components> segm must be LxHxW");
+  // list adjacent pairs, run by run
+  long *pairs = NULL;
+  long npairs = videograph::adjacency(runs, &pairs);
+  videograph_check(npairs, "adjacency");
 
-  // get dims
-  int length = segm->size[0];
-  int height = segm->size[1];
-  int width = segm->size[2];
+  // generate output
+  setneighbors(L, matrix, pairs, npairs);
+  free(pairs);
+  return 1;
+}
 
-  // (0) create a hash table to store all components
+// pushes a hash table of components: x,y,z,size,index,hash,bbox...
+static void videograph_(pushcomponents)(lua_State *L, const real *stats, long ncomps) {
   lua_newtable(L);
   int table_hash = lua_gettop(L);
+  long c;
+  for (c = 0; c < ncomps; c++) {
+    THTensor *entry = THTensor_(newWithSize1d)(videograph::STATS_SIZE);
+    memcpy(THTensor_(data)(entry), stats + c*videograph::STATS_SIZE, videograph::STATS_SIZE*sizeof(real));
+    lua_pushinteger(L, (long)stats[c*videograph::STATS_SIZE+5]);
+    luaT_pushudata(L, entry, torch_Tensor);
+    lua_rawset(L, table_hash); // g[segm_id] = entry
+  }
+}
+
+int videograph_(segm2components)(lua_State *L) {
+  // get args
+  THTensor *segm = THTensor_(newContiguous)((THTensor *)luaT_checkudata(L, 1, torch_Tensor));
+
+  // get dims
+  videograph::Volume vol;
+  volume_geometry(&vol, segm, "segm2components");
+
+  // get components' info
+  real *stats = NULL;
+  long ncomps = videograph::componentstats((const real *)THTensor_(data)(segm), vol, &stats);
+  THTensor_(free)(segm);
+  videograph_check(ncomps, "segm2components");
+
+  // create a hash table to store all components
+  videograph_(pushcomponents)(L, stats, ncomps);
+
+  // cleanup
+  free(stats);
+
+  // return component table
+  return 1;
+}
+
+int videograph_(segm2componentsruns)(lua_State *L) {
+  // get args
+  videograph::Runs runs;
+  runs_geometry(&runs, L, 1, "segm2components");
+
+  // get components' info, run by run
+  real *stats = NULL;
+  long ncomps = videograph::componentstats(runs, &stats);
+  videograph_check(ncomps, "segm2components");
+
+  // create a hash table to store all components
+  videograph_(pushcomponents)(L, stats, ncomps);
+  free(stats);
+  return 1;
+}
+
+int videograph_(poolcomponents)(lua_State *L) {
+  // get args
+  THTensor *mean = (THTensor *)luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *maxp = (THTensor *)luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *hist = (THTensor *)luaT_checkudata(L, 3, torch_Tensor);
+  THTensor *segm = THTensor_(newContiguous)((THTensor *)luaT_checkudata(L, 4, torch_Tensor));
+  THTensor *feats = (THTensor *)luaT_checkudata(L, 5, torch_Tensor);
+  int nbins = lua_tonumber(L, 6);
+  real hmin = lua_tonumber(L, 7);
+  real hmax = lua_tonumber(L, 8);
+
+  // check dims
+  videograph::Volume vol;
+  volume_geometry(&vol, segm, "poolcomponents");
+  videograph::Video v;
+  video_geometry(&v, feats);
+  if (v.length != vol.length || v.height != vol.height || v.width != vol.width)
+    THError("<videograph.poolcomponents> features must be LxKxHxW, with segm being LxHxW");
+
+  // dense index of each voxel (same mapping as segm2components)
+  long *index = NULL;
+  long ncomps = videograph::densemap((const real *)THTensor_(data)(segm),
+                                     vol.length*vol.height*vol.width, &index);
+  THTensor_(free)(segm);
+  videograph_check(ncomps, "poolcomponents");
+
+  // outputs
+  THTensor_(resize2d)(mean, ncomps, v.channels);
+  THTensor_(resize2d)(maxp, ncomps, v.channels);
+  if (nbins > 0) THTensor_(resize3d)(hist, ncomps, v.channels, nbins);
+
+  // pool
+  int status = videograph::poolcomponents(THTensor_(data)(mean), THTensor_(data)(maxp),
+                                          (nbins > 0) ? THTensor_(data)(hist) : (real *)NULL,
+                                          index, ncomps,
+                                          (const real *)THTensor_(data)(feats), v, nbins, hmin, hmax);
+
+  // cleanup
+  free(index);
+  videograph_check(status, "poolcomponents");
+
+  // push number of components
+  lua_pushnumber(L, ncomps);
+
+  // return
+  return 1;
+}
+
+int videograph_(connectedcomponents)(lua_State *L) {
+  // get args
+  THTensor *dst = (THTensor *)luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *segm = THTensor_(newContiguous)((THTensor *)luaT_checkudata(L, 2, torch_Tensor));
+  int connex = lua_tonumber(L, 3);
+
+  // dims
+  videograph::Volume vol;
+  volume_geometry(&vol, segm, "connectedcomponents");
+
+  // relabel
+  THTensor_(resize3d)(dst, vol.length, vol.height, vol.width);
+  long ncomps = videograph::connectedcomponents(THTensor_(data)(dst), (const real *)THTensor_(data)(segm),
+                                                vol, connex);
+  THTensor_(free)(segm);
+  videograph_check(ncomps, "connectedcomponents");
+
+  // push number of components
+  lua_pushnumber(L, ncomps);
+
+  // return
+  return 1;
+}
+
+// asynchronous pipeline: input tensors are retained until their
+// result is collected, so that the pipeline can read them in place
+typedef struct {
+  std::future<videograph::Result<real> > result;
+  THTensor *src;
+  THByteTensor *bsrc;
+} videograph_(PendingChunk);
+
+typedef struct {
+  videograph::Pipeline<real> *pipeline;
+  std::deque<videograph_(PendingChunk)> *pending;
+  videograph::Result<real> *result;   // result being exported (see _result)
+} videograph_(PipelineHandle);
+
+static int videograph_(Pipeline_new)(lua_State *L) {
+  // get args
+  videograph::PipelineOptions options;
+  options.connex = lua_tonumber(L, 1);
+  options.dt = lua_tostring(L, 2)[0];
+  options.thres = lua_tonumber(L, 3);
+  options.minsize = lua_tonumber(L, 4);
+  options.adaptive = lua_toboolean(L, 5);
+  options.stats = lua_toboolean(L, 6);
+  options.adjacency = lua_toboolean(L, 7);
+  options.queue = lua_tonumber(L, 8);
+  if (videograph::stencilplanes(options.connex) < 0)
+    THError("<videograph.Pipeline> connexity must be 6, 8, 18, 26 or '6t2'");
+
+  // create pipeline (starts its worker threads)
+  videograph_(PipelineHandle) *handle = new videograph_(PipelineHandle);
+  handle->pipeline = new videograph::Pipeline<real>(options);
+  handle->pending = new std::deque<videograph_(PendingChunk)>();
+  handle->result = NULL;
+  luaT_pushudata(L, handle, videograph_Pipeline);
+  return 1;
+}
 
-  // (1) get components' info
-  long x,y,z;
-  for (z=0; z<length; z++) {
-    for (y=0; y<height; y++) {
-      for (x=0; x<width; x++) {
-        // get component ID
-        int segm_id = segm_data[(height*z+y)*width+x];
-
-        // get geometry entry
-        lua_pushinteger(L,segm_id);
-        lua_rawget(L,table_hash);
-        if (lua_isnil(L,-1)) {
-          // g[segm_id] = nil
-          lua_pop(L,1);
-
-          // then create a table to store geometry of component:
-          // x,y,size,class,hash
-          THTensor *entry = THTensor_(newWithSize1d)(18);
-          real *data = THTensor_(data)(entry);
-          data[0] = x+1;       // x
-          data[1] = y+1;       // y
-          data[2] = z+1;       // z
-          data[3] = 1;         // size
-          data[4] = 0;         // compat with 'histpooling' method
-          data[5] = segm_id;   // hash
-          data[6] = x+1;       // left_x
-          data[7] = x+1;       // right_x
-          data[8] = y+1;       // top_y
-          data[9] = y+1;       // bottom_y
-          data[10] = z+1;       // first_z
-          data[11] = z+1;       // last_z
-
-          // store entry
-          lua_pushinteger(L,segm_id);
-          luaT_pushudata(L, entry, torch_Tensor);
-          lua_rawset(L,table_hash); // g[segm_id] = entry
-
-        } else {
-          // retrieve entry
-          THTensor *entry = (THTensor *)luaT_toudata(L, -1, torch_Tensor);
-          lua_pop(L,1);
-
-          // update content
-          real *data = THTensor_(data)(entry);
-          data[0] += x+1;       // x += x + 1
-          data[1] += y+1;       // y += y + 1
-          data[2] += z+1;       // z += z + 1
-          data[3] += 1;         // size += 1
-          data[6] = (x+1)<data[6] ? x+1 : data[6];   // left_x
-          data[7] = (x+1)>data[7] ? x+1 : data[7];   // right_x
-          data[8] = (y+1)<data[8] ? y+1 : data[8];   // top_y
-          data[9] = (y+1)>data[9] ? y+1 : data[9];   // bottom_y
-          data[10] = (z+1)<data[10] ? z+1 : data[10];   // first_z
-          data[11] = (z+1)>data[11] ? z+1 : data[11];   // last_z
-        }
-      }
-    }
+static void videograph_(Pipeline_release)(videograph_(PendingChunk) &chunk) {
+  if (chunk.src) THTensor_(free)(chunk.src);
+  if (chunk.bsrc) THByteTensor_free(chunk.bsrc);
+}
+
+static int videograph_(Pipeline_free)(lua_State *L) {
+  videograph_(PipelineHandle) *handle = (videograph_(PipelineHandle) *)luaT_checkudata(L, 1, videograph_Pipeline);
+  // finishes pending chunks (which still read their inputs), then joins
+  delete handle->pipeline;
+  while (!handle->pending->empty()) {
+    videograph_(Pipeline_release)(handle->pending->front());
+    handle->pending->pop_front();
   }
+  delete handle->pending;
+  delete handle->result;
+  delete handle;
+  return 0;
+}
 
-  // (2) traverse geometry table to produce final component list
-  lua_pushnil(L);
-  while (lua_next(L, table_hash) != 0) {
-    // retrieve entry
-    THTensor *entry = (THTensor *)luaT_toudata(L, -1, torch_Tensor); lua_pop(L,1);
-    real *data = THTensor_(data)(entry);
-
-    // normalize cx and cy, by component's size
-    long size = data[3];
-    data[0] /= size;  // cx/size
-    data[1] /= size;  // cy/size
-    data[2] /= size;  // cz/size
-
-    // extra info
-    data[12] = data[7] - data[6] + 1;     // box width
-    data[13] = data[9] - data[8] + 1;    // box height
-    data[14] = data[11] - data[10] + 1;    // box length
-    data[15] = (data[7] + data[6]) / 2;  // box center x
-    data[16] = (data[9] + data[8]) / 2;  // box center y
-    data[17] = (data[11] + data[10]) / 2;  // box center z
+static int videograph_(Pipeline_submit)(lua_State *L) {
+  // get args
+  videograph_(PipelineHandle) *handle = (videograph_(PipelineHandle) *)luaT_checkudata(L, 1, videograph_Pipeline);
+  THTensor *src = (THTensor *)luaT_toudata(L, 2, torch_Tensor);
+  THByteTensor *bsrc = NULL;
+  if (!src) bsrc = video_bytes(L, 2, "Pipeline", "the pipeline");
+
+  // get input geometry (no copy is made, strides are used as is); all
+  // the checks are done here, before any C++ object is created, as
+  // THError does not unwind them
+  videograph::Video v;
+  if (src) video_geometry(&v, src);
+  else video_geometry(&v, bsrc);
+
+  // keep input alive, and submit (blocks if the pipeline is full)
+  videograph_(PendingChunk) chunk;
+  chunk.src = src;
+  chunk.bsrc = bsrc;
+  if (chunk.src) {
+    THTensor_(retain)(chunk.src);
+    chunk.result = handle->pipeline->submit((const real *)THTensor_(data)(chunk.src), v);
+  } else {
+    THByteTensor_retain(chunk.bsrc);
+    chunk.result = handle->pipeline->submit((const unsigned char *)THByteTensor_data(chunk.bsrc), v);
   }
+  handle->pending->push_back(std::move(chunk));
 
-  // return component table
+  // return number of pending chunks
+  lua_pushnumber(L, handle->pending->size());
+  return 1;
+}
+
+static int videograph_(Pipeline_result)(lua_State *L) {
+  // get args
+  videograph_(PipelineHandle) *handle = (videograph_(PipelineHandle) *)luaT_checkudata(L, 1, videograph_Pipeline);
+  THTensor *segm = (THTensor *)luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *stats = (THTensor *)luaT_checkudata(L, 3, torch_Tensor);
+  THLongTensor *pairs = (THLongTensor *)luaT_checkudata(L, 4, "torch.LongTensor");
+  if (handle->pending->empty())
+    THError("<videograph.Pipeline> no chunk was submitted");
+
+  // wait for next chunk (in submission order); the scoped C++ objects
+  // are released before exporting it, and the result itself is held by
+  // the handle (released by the next call, or free), so that no C++
+  // object is live when an error is raised
+  {
+    videograph_(PendingChunk) chunk = std::move(handle->pending->front());
+    handle->pending->pop_front();
+    delete handle->result;
+    handle->result = NULL;
+    handle->result = new videograph::Result<real>(chunk.result.get());
+    videograph_(Pipeline_release)(chunk);
+  }
+  videograph::Result<real> *result = handle->result;
+  videograph_check(result->status, "Pipeline");
+
+  // export it
+  THTensor_(resize3d)(segm, result->vol.length, result->vol.height, result->vol.width);
+  memcpy(THTensor_(data)(segm), &result->labels[0], result->labels.size()*sizeof(real));
+  long nstats = result->stats.size() / videograph::STATS_SIZE;
+  if (nstats > 0) {
+    THTensor_(resize2d)(stats, nstats, videograph::STATS_SIZE);
+    memcpy(THTensor_(data)(stats), &result->stats[0], result->stats.size()*sizeof(real));
+  }
+  long npairs = result->pairs.size() / 2;
+  if (npairs > 0) {
+    THLongTensor_resize2d(pairs, npairs, 2);
+    memcpy(THLongTensor_data(pairs), &result->pairs[0], result->pairs.size()*sizeof(long));
+  }
+  long ncomps = result->ncomps;
+  long index = result->index;
+  delete handle->result;
+  handle->result = NULL;
+
+  // return number of components, and chunk index
+  lua_pushnumber(L, ncomps);
+  lua_pushnumber(L, index+1);
+  return 2;
+}
+
+static int videograph_(Pipeline_pending)(lua_State *L) {
+  videograph_(PipelineHandle) *handle = (videograph_(PipelineHandle) *)luaT_checkudata(L, 1, videograph_Pipeline);
+  lua_pushnumber(L, handle->pending->size());
+  return 1;
+}
+
+static const struct luaL_Reg videograph_(Pipeline__) [] = {
+  {"_submit", videograph_(Pipeline_submit)},
+  {"_result", videograph_(Pipeline_result)},
+  {"pending", videograph_(Pipeline_pending)},
+  {NULL, NULL}
+};
+
+// incremental segmentation: frames are only read during append
+static int videograph_(Stream_new)(lua_State *L) {
+  // get args
+  videograph::StreamOptions options;
+  options.connex = lua_tonumber(L, 1);
+  options.dt = lua_tostring(L, 2)[0];
+  options.thres = lua_tonumber(L, 3);
+  options.minsize = lua_tonumber(L, 4);
+  options.adaptive = lua_toboolean(L, 5);
+  if (videograph::stencilplanes(options.connex) < 0)
+    THError("<videograph.Stream> connexity must be 6, 8, 18, 26 or '6t2'");
+
+  videograph::Stream<real> *stream = new videograph::Stream<real>(options);
+  luaT_pushudata(L, stream, videograph_Stream);
+  return 1;
+}
+
+static int videograph_(Stream_free)(lua_State *L) {
+  videograph::Stream<real> *stream = (videograph::Stream<real> *)luaT_checkudata(L, 1, videograph_Stream);
+  delete stream;
+  return 0;
+}
+
+static int videograph_(Stream_append)(lua_State *L) {
+  // get args
+  videograph::Stream<real> *stream = (videograph::Stream<real> *)luaT_checkudata(L, 1, videograph_Stream);
+  THTensor *src = (THTensor *)luaT_toudata(L, 2, torch_Tensor);
+  THByteTensor *bsrc = NULL;
+  if (!src) bsrc = video_bytes(L, 2, "Stream", "the stream");
+  long overlap = lua_tonumber(L, 3);
+
+  // get input geometry (no copy is made, strides are used as is)
+  videograph::Video v;
+  if (src) video_geometry(&v, src);
+  else video_geometry(&v, bsrc);
+
+  // weight, and merge the new frames
+  long ncomps;
+  if (src) ncomps = stream->append((const real *)THTensor_(data)(src), v, overlap);
+  else ncomps = stream->append((const unsigned char *)THByteTensor_data(bsrc), v, overlap);
+  videograph_check(ncomps, "Stream");
+
+  // return number of components
+  lua_pushnumber(L, ncomps);
   return 1;
 }
 
+// frames [first,first+count) (0-based, not retired), checked
+static void videograph_(Stream_range)(lua_State *L, videograph::Stream<real> *stream, int index,
+                                      long *first, long *count) {
+  *first = lua_tonumber(L, index);
+  *count = lua_tonumber(L, index+1);
+  if (*first < stream->retired() || *count <= 0 || *first + *count > stream->volume().length)
+    THError("<videograph.Stream> frames out of range");
+}
+
+static int videograph_(Stream_labels)(lua_State *L) {
+  // get args
+  videograph::Stream<real> *stream = (videograph::Stream<real> *)luaT_checkudata(L, 1, videograph_Stream);
+  THTensor *dst = (THTensor *)luaT_checkudata(L, 2, torch_Tensor);
+  long first, count;
+  videograph_(Stream_range)(L, stream, 3, &first, &count);
+
+  // write labels
+  videograph::Volume vol = stream->volume();
+  THTensor_(resize3d)(dst, count, vol.height, vol.width);
+  int status = stream->labels(THTensor_(data)(dst), first, count);
+  videograph_check(status, "Stream");
+  return 0;
+}
+
+static int videograph_(Stream_runs)(lua_State *L) {
+  // get args
+  videograph::Stream<real> *stream = (videograph::Stream<real> *)luaT_checkudata(L, 1, videograph_Stream);
+  THLongTensor *rows = (THLongTensor *)luaT_checkudata(L, 2, "torch.LongTensor");
+  THIntTensor *runs = (THIntTensor *)luaT_checkudata(L, 3, "torch.IntTensor");
+  long first, count;
+  videograph_(Stream_range)(L, stream, 4, &first, &count);
+
+  // write labels, straight into runs
+  videograph::Runs labels;
+  int status = stream->labels(&labels, first, count);
+  videograph_check(status, "Stream");
+  runs_export(&labels, rows, runs);
+  return 0;
+}
+
+static int videograph_(Stream_size)(lua_State *L) {
+  videograph::Stream<real> *stream = (videograph::Stream<real> *)luaT_checkudata(L, 1, videograph_Stream);
+  videograph::Volume vol = stream->volume();
+  lua_pushnumber(L, vol.length);
+  lua_pushnumber(L, vol.height);
+  lua_pushnumber(L, vol.width);
+  return 3;
+}
+
+static int videograph_(Stream_retire)(lua_State *L) {
+  videograph::Stream<real> *stream = (videograph::Stream<real> *)luaT_checkudata(L, 1, videograph_Stream);
+  long nframes = lua_tonumber(L, 2);
+  if (nframes < 0 || nframes > stream->volume().length - stream->retired())
+    THError("<videograph.Stream> cannot retire more frames than are left");
+  int status = stream->retire(nframes);
+  videograph_check(status, "Stream");
+  return 0;
+}
+
+static int videograph_(Stream_retired)(lua_State *L) {
+  videograph::Stream<real> *stream = (videograph::Stream<real> *)luaT_checkudata(L, 1, videograph_Stream);
+  lua_pushnumber(L, stream->retired());
+  return 1;
+}
+
+static int videograph_(Stream_ncomps)(lua_State *L) {
+  videograph::Stream<real> *stream = (videograph::Stream<real> *)luaT_checkudata(L, 1, videograph_Stream);
+  lua_pushnumber(L, stream->ncomps());
+  return 1;
+}
+
+static const struct luaL_Reg videograph_(Stream__) [] = {
+  {"_append", videograph_(Stream_append)},
+  {"_labels", videograph_(Stream_labels)},
+  {"_runs", videograph_(Stream_runs)},
+  {"retire", videograph_(Stream_retire)},
+  {"retired", videograph_(Stream_retired)},
+  {"size", videograph_(Stream_size)},
+  {"ncomps", videograph_(Stream_ncomps)},
+  {NULL, NULL}
+};
+
 static const struct luaL_Reg videograph_(methods__) [] = {
   {"graph", videograph_(graph)},
   {"flowgraph", videograph_(flowgraph)},
   {"segmentmst", videograph_(segmentmst)},
+  {"savegraph", videograph_(savegraph)},
+  {"segmentcached", videograph_(segmentcached)},
+  {"segmentruns", videograph_(segmentruns)},
+  {"encoderuns", videograph_(encoderuns)},
+  {"decoderuns", videograph_(decoderuns)},
   {"colorize", videograph_(colorize)},
+  {"colorizeruns", videograph_(colorizeruns)},
   {"adjacency", videograph_(adjacency)},
+  {"adjacencyruns", videograph_(adjacencyruns)},
   {"segm2components", videograph_(segm2components)},
+  {"segm2componentsruns", videograph_(segm2componentsruns)},
+  {"poolcomponents", videograph_(poolcomponents)},
+  {"connectedcomponents", videograph_(connectedcomponents)},
   {NULL, NULL}
 };
 
@@ -788,6 +925,16 @@ static void videograph_(Init)(lua_State *L)
   luaT_pushmetatable(L, torch_Tensor);
   luaT_registeratname(L, videograph_(methods__), "videograph");
   lua_pop(L,1);
+
+  luaT_newmetatable(L, videograph_Pipeline, NULL,
+                    videograph_(Pipeline_new), videograph_(Pipeline_free), NULL);
+  luaL_register(L, NULL, videograph_(Pipeline__));
+  lua_pop(L,1);
+
+  luaT_newmetatable(L, videograph_Stream, NULL,
+                    videograph_(Stream_new), videograph_(Stream_free), NULL);
+  luaL_register(L, NULL, videograph_(Stream__));
+  lua_pop(L,1);
 }
 
 #endif
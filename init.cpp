@@ -2,10 +2,14 @@
 #include "luaT.h"
 
 #include "stdint.h"
-#include "set.h"
+#include "core/videograph.h"
+#include "core/pipeline.h"
+#include "core/stream.h"
 
 #define torch_(NAME) TH_CONCAT_3(torch_, Real, NAME)
 #define torch_Tensor TH_CONCAT_STRING_3(torch., Real, Tensor)
+#define videograph_Pipeline TH_CONCAT_STRING_3(videograph., Real, Pipeline)
+#define videograph_Stream TH_CONCAT_STRING_3(videograph., Real, Stream)
 #define videograph_(NAME) TH_CONCAT_3(videograph_, Real, NAME)
 #define nn_(NAME) TH_CONCAT_3(nn_, Real, NAME)
 
@@ -17,6 +21,7 @@ extern "C" {
   {
     videograph_FloatInit(L);
     videograph_DoubleInit(L);
+    videograph_GraphFileInit(L);
 
     return 1;
   }
@@ -34,6 +34,23 @@ videograph = {}
 -- c lib:
 require 'libvideograph'
 
+-- supported neighborhoods: connexity -> number of graph planes
+-- (6: x,y,t; 8: 8 in space + t; 18; 26: full cube; '6t2': 6 + a
+-- second temporal link, t+2, which is not a full neighborhood)
+videograph.stencils = {[6]=3, [8]=5, [18]=9, [26]=13, ['6t2']=4}
+
+-- code of a connexity in the C library (numbers are their own code)
+local connexcodes = {['6t2']=106}
+local function connexcode(connex)
+   return connexcodes[connex] or connex
+end
+
+-- memory-mapped reader for uncompressed videos:
+torch.include('videograph', 'rawvideo.lua')
+
+-- run-length encoded segmentation maps:
+torch.include('videograph', 'rle.lua')
+
 ----------------------------------------------------------------------
 -- computes a graph from a video (3D or 4D array)
 --
@@ -61,33 +78,38 @@ function videograph.graph(...)
               or ((distance == 'angle') and 'a') or ((distance == 'max') and 'm') 
 
    -- usage
-   if not video or (connex ~= 6 and connex ~= 26) or (distance ~= 'e' and distance ~= 'a' and distance ~= 'm') then
+   if not video or not videograph.stencils[connex] or (distance ~= 'e' and distance ~= 'a' and distance ~= 'm') then
       print(xlua.usage('videograph.graph',
                        'compute an edge-weighted graph on a video sequence\n'
                        .. '(if a flow field is passed, edges are warped through time, accoring to the field;\n'
                        .. ' the field should be computed backwards, i.e. from frame (t+1) to frame (t)',
                        nil,
-                       {type='torch.Tensor', help='input tensor (for now LxKxHxW or LxHxW)', req=true},
-                       {type='number', help='connexity (edges per vertex): 6 | 26', default=6},
+                       {type='torch.Tensor', help='input tensor (LxKxHxW or LxHxW, Float/Double/Byte, can be strided)', req=true},
+                       {type='number | string', help='connexity (edges per vertex): 6 | 8 | 18 | 26, or \'6t2\' (6, plus t+2)', default=6},
                        {type='string', help='distance metric: euclid | angle | max', req='euclid'},
                        {type='torch.Tensor', help='optional flow field, to constrain time edges (Lx2xHxW)'},
                        "",
                        {type='torch.Tensor', help='destination: existing graph', req=true},
-                       {type='torch.Tensor', help='input tensor (for now LxKxHxW or LxHxW)', req=true},
+                       {type='torch.Tensor', help='input tensor (LxKxHxW or LxHxW, Float/Double/Byte, can be strided)', req=true},
                        {type='number', help='connexity (edges per vertex): 6', default=6},
                        {type='string', help='distance metric: euclid | angle | max', req='euclid'},
                        {type='torch.Tensor', help='optional flow field, to constrain time edges (Lx2xHxW)'}))
       xlua.error('incorrect arguments', 'videograph.graph')
    end
 
-   -- create dest
-   dest = dest or torch.Tensor():typeAs(video)
+   -- create dest: raw (uint8) videos are read in place, and
+   -- produce a graph of the default type
+   if torch.typename(video) == 'torch.ByteTensor' then
+      dest = dest or torch.Tensor()
+   else
+      dest = dest or torch.Tensor():typeAs(video)
+   end
 
-   -- compute graph
+   -- compute graph (the video can be a strided view, it is never copied)
    if flow then
-      video.videograph.flowgraph(dest, video, flow, connex, distance)
+      dest.videograph.flowgraph(dest, video, flow:typeAs(dest), connexcode(connex), distance)
    else
-      video.videograph.graph(dest, video, connex, distance)
+      dest.videograph.graph(dest, video, connexcode(connex), distance)
    end
 
    -- return result
@@ -103,7 +125,7 @@ function videograph.segmentmst(...)
    local args = {...}
    local dest, graph, thres, minsize, colorize
    local arg2 = torch.typename(args[2])
-   if arg2 and arg2:find('Tensor') then
+   if arg2 and (arg2:find('Tensor') or arg2 == 'videograph.GraphFile') then
       dest = args[1]
       graph = args[2]
       thres = args[3]
@@ -130,14 +152,14 @@ function videograph.segmentmst(...)
                        'segment an edge-weighted graph, by thresholding its mininum spanning tree\n'
                        ..'(an adaptive threshold is used by default, as in Felzenszwalb et al.)',
                        nil,
-                       {type='torch.Tensor', help='input graph', req=true},
+                       {type='torch.Tensor | videograph.GraphFile', help='input graph (or graph file, see loadgraph)', req=true},
                        {type='number', help='base threshold for merging', default=3},
                        {type='number', help='min size: merge components of smaller size', default=20},
                        {type='boolean', help='replace components id by random colors', default=false},
                        {type='boolean', help='use adaptive threshold (Felzenszwalb trick)', default=true},
                        "",
                        {type='torch.Tensor', help='destination tensor', req=true},
-                       {type='torch.Tensor', help='input graph', req=true},
+                       {type='torch.Tensor | videograph.GraphFile', help='input graph (or graph file, see loadgraph)', req=true},
                        {type='number', help='base threshold for merging', default=3},
                        {type='number', help='min size: merge components of smaller size', default=20},
                        {type='boolean', help='replace components id by random colors', default=false},
@@ -145,6 +167,13 @@ function videograph.segmentmst(...)
       xlua.error('incorrect arguments', 'videograph.segmentmst')
    end
 
+   -- graph file: segment its (already sorted) edges in place
+   if torch.typename(graph) == 'videograph.GraphFile' then
+      dest = dest or torch.Tensor()
+      local nelts = dest.videograph.segmentcached(dest, graph, thres, minsize, adaptive, colorize)
+      return dest, nelts
+   end
+
    -- compute segmented video
    dest = dest or torch.Tensor():typeAs(graph)
    local nelts
@@ -160,6 +189,73 @@ function videograph.segmentmst(...)
    return dest, nelts
 end
 
+----------------------------------------------------------------------
+-- same as segmentmst, but produces a run-length encoded map (see
+-- videograph.RLE): no dense map is ever allocated
+--
+function videograph.segmentruns(...)
+   local _, graph, thres, minsize, adaptive = xlua.unpack(
+      {...},
+      'videograph.segmentruns',
+      'segment an edge-weighted graph (as segmentmst), into a run-length\n'
+         .. 'encoded segmentation map',
+      {arg='graph', type='torch.Tensor | videograph.GraphFile', help='input graph (or graph file, see loadgraph)', req=true},
+      {arg='thres', type='number', help='base threshold for merging', default=3},
+      {arg='minsize', type='number', help='min size: merge components of smaller size', default=20},
+      {arg='adaptive', type='boolean', help='use adaptive threshold (Felzenszwalb trick)', default=true}
+   )
+
+   -- segment
+   local rle = videograph.RLE()
+   local proto = (torch.typename(graph) == 'videograph.GraphFile') and torch.Tensor() or graph
+   local nelts = proto.videograph.segmentruns(rle.rows, rle.runs, graph, thres, minsize, adaptive)
+
+   -- dims
+   if torch.typename(graph) == 'videograph.GraphFile' then
+      local info = graph:info()
+      rle.length, rle.height, rle.width = info.length, info.height, info.width
+   else
+      rle.length, rle.height, rle.width = graph:size(1), graph:size(3), graph:size(4)
+   end
+
+   -- return encoded segmentation, and number of components
+   return rle, nelts
+end
+
+----------------------------------------------------------------------
+-- save a graph's sorted edges to a binary graph file, which can then
+-- be segmented many times, without rebuilding or sorting the graph
+--
+function videograph.savegraph(...)
+   local _, path, graph, distance, quant = xlua.unpack(
+      {...},
+      'videograph.savegraph',
+      'save a graph (LxKxHxW, see videograph.graph) as a graph file: its edges\n'
+         .. 'are stored sorted, so that videograph.loadgraph + videograph.segmentmst\n'
+         .. 'can skip graph construction and sorting',
+      {arg='path', type='string', help='path of the graph file', req=true},
+      {arg='graph', type='torch.Tensor', help='input graph', req=true},
+      {arg='distance', type='string', help='distance metric the graph was computed with (recorded)', default='euclid'},
+      {arg='quant', type='number', help='quantize weights: 0 (float) | 8 | 16 bits', default=0}
+   )
+   distance = ((distance == 'angle') and 'a') or ((distance == 'max') and 'm') or 'e'
+   if quant ~= 0 and quant ~= 8 and quant ~= 16 then
+      xlua.error('quant must be 0, 8 or 16', 'videograph.savegraph')
+   end
+   graph.videograph.savegraph(graph, path, distance, quant)
+end
+
+----------------------------------------------------------------------
+-- map a graph file (see savegraph): the result can be passed to
+-- segmentmst in place of a graph; info() describes it
+--
+function videograph.loadgraph(path)
+   if not path then
+      xlua.error('please provide the path of a graph file', 'videograph.loadgraph')
+   end
+   return videograph.GraphFile(path)
+end
+
 ----------------------------------------------------------------------
 -- extract information/geometry of a segmentation's components
 --
@@ -186,7 +282,7 @@ function videograph.extractcomponents(...)
             'graph = videograph.graph(image.lena())\n'
                .. 'segm = videograph.segmentmst(graph)\n'
                .. 'components = videograph.extractcomponents(segm)',
-            {type='torch.Tensor',  help='input segmentation map (must be LxHxW), and each element must be in [1,NCLASSES]', req=true},
+            {type='torch.Tensor | videograph.RLE',  help='input segmentation map (must be LxHxW, or run-length encoded), and each element must be in [1,NCLASSES]', req=true},
             {type='torch.Tensor', help='auxiliary video: if given, then components are cropped from it (must be LxKxHxW)'},
             {type='string', help='configuration, one of: bbox | masked', default='bbox'},
             {type='function', help='encoder: function that encodes cropped/masked patches into a code (doing it here can save a lot of memory)'},
@@ -204,7 +300,12 @@ function videograph.extractcomponents(...)
    -- generate lists
    local hcomponents
    local masks = {}
-   if torch.typename(input) then
+   if torch.typename(input) == 'videograph.RLE' then
+      hcomponents = torch.Tensor().videograph.segm2componentsruns(input.rows, input.runs,
+                                                                   input.length, input.height, input.width)
+      -- masks are cropped from the dense map
+      if video and video:nDimension() == 4 then input = input:decode() end
+   elseif torch.typename(input) then
       hcomponents = input.videograph.segm2components(input)
    else
       error('please provide input')
@@ -212,7 +313,7 @@ function videograph.extractcomponents(...)
 
    -- reorganize
    local components = {centroid_x={}, centroid_y={}, centroid_z={}, surface={}, 
-                       id = {}, revid = {},
+                       id = {}, revid = {}, pool_index = {},
                        bbox_width = {}, bbox_height = {}, bbox_length = {},
                        bbox_top = {}, bbox_bottom = {}, 
                        bbox_left = {}, bbox_right = {},
@@ -225,6 +326,7 @@ function videograph.extractcomponents(...)
       components.centroid_y[i]  = comp[2]
       components.centroid_z[i]  = comp[3]
       components.surface[i]     = comp[4]
+      components.pool_index[i]  = comp[5]
       components.id[i]          = comp[6]
       components.revid[comp[6]] = i
       components.bbox_left[i]   = comp[7]
@@ -304,6 +406,15 @@ function videograph.colorize(...)
    local grayscale = args[1]
    local colormap = args[2]
 
+   -- run-length encoded map: colorize run by run
+   if torch.typename(grayscale) == 'videograph.RLE' then
+      colormap = colormap or torch.Tensor()
+      local colorized = torch.Tensor():typeAs(colormap)
+      colorized.videograph.colorizeruns(colorized, grayscale.rows, grayscale.runs,
+                                        grayscale.length, grayscale.height, grayscale.width, colormap)
+      return colorized, colormap
+   end
+
    -- usage
    if not grayscale or not (grayscale:dim() == 3 or (grayscale:dim() == 4 and grayscale:size(2) == 1)) then
       print(xlua.usage('videograph.colorize',
@@ -311,7 +422,7 @@ function videograph.colorize(...)
                        'graph = videograph.graph(image.lena())\n'
                           .. 'segm = videograph.segmentmst(graph)\n'
                           .. 'colored = videograph.colorize(segm)',
-                       {type='torch.Tensor', help='input segmentation map (must be HxW), and each element must be in [1,width*height]', req=true},
+                       {type='torch.Tensor | videograph.RLE', help='input segmentation map (must be LxHxW, or run-length encoded), and each element must be in [1,width*height]', req=true},
                        {type='torch.Tensor', help='color map (must be Nx3), if not provided, auto generated'}))
       xlua.error('incorrect arguments', 'videograph.colorize')
    end
@@ -365,7 +476,7 @@ function videograph.adjacency(...)
                           .. 'segm = videograph.adjacency(segm, components)\n'
                           .. 'print(components.neighbors) -- list of neighbor IDs\n'
                           .. 'print(components.adjacency) -- adjacency matrix of IDs',
-                       {type='torch.Tensor', help='input segmentation map (must be LxHxW), and each element must be in [1,NCLASSES]', req=true},
+                       {type='torch.Tensor | videograph.RLE', help='input segmentation map (must be LxHxW, or run-length encoded), and each element must be in [1,NCLASSES]', req=true},
                        {type='table', help='component list, as returned by videograph.extractcomponents()'}))
       xlua.error('incorrect arguments', 'videograph.adjacency')
    end
@@ -377,7 +488,10 @@ function videograph.adjacency(...)
 
    -- fill matrix
    local adjacency
-   if torch.typename(input) then
+   if torch.typename(input) == 'videograph.RLE' then
+      adjacency = torch.Tensor().videograph.adjacencyruns(input.rows, input.runs,
+                                                           input.length, input.height, input.width, {})
+   elseif torch.typename(input) then
       adjacency = input.videograph.adjacency(input, {})
    else
       error('please provide an input')
@@ -406,6 +520,240 @@ function videograph.adjacency(...)
    return adjacency
 end
 
+----------------------------------------------------------------------
+-- pool features over the components of a segmentation
+--
+function videograph.poolcomponents(...)
+   -- get args
+   local args = {...}
+   local input = args[1]
+   local features = args[2]
+   local nbins = args[3] or 0
+   local min = args[4]
+   local max = args[5]
+
+   -- usage
+   if not input or not features or input:dim() ~= 3 or features:dim() ~= 4 then
+      print(xlua.usage('videograph.poolcomponents',
+                       'pool features over each component of a segmentation map:\n'
+                          .. 'returns NxK mean and max pooled features, and optionally\n'
+                          .. 'NxKxB per-channel histograms (N = number of components);\n'
+                          .. 'row i corresponds to the i-th smallest id, which is also\n'
+                          .. 'available as components.pool_index in extractcomponents()',
+                       'segm = videograph.segmentmst(graph)\n'
+                          .. 'components = videograph.extractcomponents(segm)\n'
+                          .. 'mean,max = videograph.poolcomponents(segm, features)\n'
+                          .. 'print(mean[components.pool_index[1]])',
+                       {type='torch.Tensor', help='input segmentation map (must be LxHxW)', req=true},
+                       {type='torch.Tensor', help='features (must be LxKxHxW, same type as segm, can be strided)', req=true},
+                       {type='number', help='number of histogram bins (0 = no histograms)', default=0},
+                       {type='number', help='histogram min (default: features:min())'},
+                       {type='number', help='histogram max (default: features:max())'}))
+      xlua.error('incorrect arguments', 'videograph.poolcomponents')
+   end
+
+   -- support LongTensors
+   if torch.typename(input) == 'torch.LongTensor' then
+      input = torch.Tensor(input:size(1), input:size(2), input:size(3)):copy(input)
+   end
+
+   -- features are read in place (never converted)
+   if torch.typename(features) ~= torch.typename(input) then
+      xlua.error('features must have the same type as segm (' .. torch.typename(input) .. ')',
+                 'videograph.poolcomponents')
+   end
+
+   -- pool (a missing histogram bound, NaN, is computed by the kernel)
+   local mean = torch.Tensor():typeAs(input)
+   local max_ = torch.Tensor():typeAs(input)
+   local hist = torch.Tensor():typeAs(input)
+   local n = input.videograph.poolcomponents(mean, max_, hist, input, features, nbins, min or 0/0, max or 0/0)
+
+   -- return pooled features
+   if nbins > 0 then
+      return mean, max_, hist, n
+   else
+      return mean, max_, nil, n
+   end
+end
+
+----------------------------------------------------------------------
+-- relabel a segmentation map into spatially connected components
+--
+function videograph.connectedcomponents(...)
+   -- get args
+   local args = {...}
+   local dest, input, connex
+   local arg2 = torch.typename(args[2])
+   if arg2 and arg2:find('Tensor') then
+      dest = args[1]
+      input = args[2]
+      connex = args[3]
+   else
+      input = args[1]
+      connex = args[2]
+   end
+
+   -- defaults
+   connex = connex or 6
+
+   -- usage
+   if not input or input:dim() ~= 3 or not videograph.stencils[connex] then
+      print(xlua.usage('videograph.connectedcomponents',
+                       'relabel a segmentation map, so that each id covers exactly one\n'
+                          .. 'connected piece (ids are compact, in [1,N], in raster order)',
+                       'segm = videograph.segmentmst(graph)\n'
+                          .. 'segm,n = videograph.connectedcomponents(segm)\n'
+                          .. 'components = videograph.extractcomponents(segm)',
+                       {type='torch.Tensor', help='input segmentation map (must be LxHxW)', req=true},
+                       {type='number | string', help='connexity: 6 | 8 | 18 | 26, or \'6t2\' (6, plus t+2)', default=6},
+                       "",
+                       {type='torch.Tensor', help='destination tensor', req=true},
+                       {type='torch.Tensor', help='input segmentation map (must be LxHxW)', req=true},
+                       {type='number | string', help='connexity: 6 | 8 | 18 | 26, or \'6t2\' (6, plus t+2)', default=6}))
+      xlua.error('incorrect arguments', 'videograph.connectedcomponents')
+   end
+
+   -- support LongTensors
+   if torch.typename(input) == 'torch.LongTensor' then
+      input = torch.Tensor(input:size(1), input:size(2), input:size(3)):copy(input)
+   end
+
+   -- relabel
+   dest = dest or torch.Tensor():typeAs(input)
+   local n = input.videograph.connectedcomponents(dest, input, connexcode(connex))
+
+   -- return relabeled map, and number of components
+   return dest, n
+end
+
+----------------------------------------------------------------------
+-- asynchronous pipeline: graph -> segmentmst -> components/adjacency,
+-- each stage running in its own thread, on a stream of chunks
+--
+function videograph.Pipeline(...)
+   local _, connex, distance, thres, minsize, adaptive, stats, adjacency, queue = xlua.unpack(
+      {...},
+      'videograph.Pipeline',
+      'create an asynchronous pipeline: chunks of frames are submitted with\n'
+         .. 'p:submit(frames), and results are collected, in order, with p:result();\n'
+         .. 'chunk n+1\'s graph is built while chunk n is segmented, and chunk n-1\n'
+         .. 'post-processed. submit() blocks while the pipeline is full, but results\n'
+         .. 'are kept until collected: collect them as you go (submit() returns the\n'
+         .. 'number of chunks not collected yet), or they pile up. Frames are read in\n'
+         .. 'place, and kept alive until their result is collected.',
+      {arg='connex', type='number | string', help='connexity (edges per vertex): 6 | 8 | 18 | 26, or \'6t2\' (6, plus t+2)', default=6},
+      {arg='distance', type='string', help='distance metric: euclid | angle | max', default='euclid'},
+      {arg='thres', type='number', help='base threshold for merging', default=3},
+      {arg='minsize', type='number', help='min size: merge components of smaller size', default=20},
+      {arg='adaptive', type='boolean', help='use adaptive threshold (Felzenszwalb trick)', default=true},
+      {arg='stats', type='boolean', help='compute component stats (as segm2components)', default=true},
+      {arg='adjacency', type='boolean', help='compute adjacent component pairs', default=true},
+      {arg='queue', type='number', help='capacity of the queues between stages', default=2}
+   )
+   distance = ((distance == 'angle') and 'a') or ((distance == 'max') and 'm') or 'e'
+   if torch.getdefaulttensortype() == 'torch.DoubleTensor' then
+      return videograph.DoublePipeline(connexcode(connex), distance, thres, minsize, adaptive, stats, adjacency, queue)
+   else
+      return videograph.FloatPipeline(connexcode(connex), distance, thres, minsize, adaptive, stats, adjacency, queue)
+   end
+end
+
+for _,Real in ipairs{'Float', 'Double'} do
+   local Pipeline = torch.getmetatable('videograph.' .. Real .. 'Pipeline')
+
+   -- submit a chunk of frames (LxKxHxW or LxHxW, Byte or same type);
+   -- returns the number of chunks whose result is not collected yet
+   function Pipeline:submit(frames)
+      return self:_submit(frames)
+   end
+
+   -- wait for the next result: returns the segmentation (LxHxW),
+   -- the number of components, the component stats (Nx18, records as
+   -- in segm2components), the adjacent pairs (Mx2), and the chunk index
+   function Pipeline:result()
+      local segm = torch[Real .. 'Tensor']()
+      local stats = torch[Real .. 'Tensor']()
+      local pairs = torch.LongTensor()
+      local n, index = self:_result(segm, stats, pairs)
+      return segm, n, stats, pairs, index
+   end
+end
+
+----------------------------------------------------------------------
+-- incremental segmentation, for live processing: frames are appended
+-- in chunks, and only the new frames' edges are built and merged into
+-- the segmentation of all the frames appended so far
+--
+function videograph.Stream(...)
+   local _, connex, distance, thres, minsize, adaptive = xlua.unpack(
+      {...},
+      'videograph.Stream',
+      'create an incremental segmentation: chunks of frames are appended with\n'
+         .. 's:append(frames, overlap), the first overlap frames of a chunk being the\n'
+         .. 'last frames already appended (as produced by RawVideo:chunks(size, overlap));\n'
+         .. 'only the new frames\' spatial edges, and the temporal edges linking them to\n'
+         .. 'the previous frames are computed. Labels of any appended frames are read\n'
+         .. 'with s:labels(first, last), or s:runs(first, last) (videograph.RLE).\n'
+         .. 'Components are merged chunk by chunk: for a single chunk, the result is\n'
+         .. 'that of segmentmst. The stream keeps all the frames appended, until\n'
+         .. 'the oldest ones are dropped with s:retire(n): a live stream keeps a\n'
+         .. 'window of frames this way (frame numbers and component ids are kept).',
+      {arg='connex', type='number | string', help='connexity (edges per vertex): 6 | 8 | 18 | 26, or \'6t2\' (6, plus t+2)', default=6},
+      {arg='distance', type='string', help='distance metric: euclid | angle | max', default='euclid'},
+      {arg='thres', type='number', help='base threshold for merging', default=3},
+      {arg='minsize', type='number', help='min size: merge components of smaller size', default=20},
+      {arg='adaptive', type='boolean', help='use adaptive threshold (Felzenszwalb trick)', default=true}
+   )
+   if not videograph.stencils[connex] then
+      xlua.error('connexity must be 6, 8, 18, 26 or \'6t2\'', 'videograph.Stream')
+   end
+   distance = ((distance == 'angle') and 'a') or ((distance == 'max') and 'm') or 'e'
+   if torch.getdefaulttensortype() == 'torch.DoubleTensor' then
+      return videograph.DoubleStream(connexcode(connex), distance, thres, minsize, adaptive)
+   else
+      return videograph.FloatStream(connexcode(connex), distance, thres, minsize, adaptive)
+   end
+end
+
+for _,Real in ipairs{'Float', 'Double'} do
+   local Stream = torch.getmetatable('videograph.' .. Real .. 'Stream')
+
+   -- number of frames appended
+   function Stream:length()
+      return (self:size())
+   end
+
+   -- append a chunk of frames (LxKxHxW or LxHxW, Byte or same type),
+   -- whose first overlap frames were already appended (the overlap is
+   -- capped to the frames left: a stream starts with none);
+   -- returns the number of components
+   function Stream:append(frames, overlap)
+      overlap = math.min(overlap or 0, self:length() - self:retired())
+      return self:_append(frames, overlap)
+   end
+
+   -- labels of frames first..last (default: all those not retired),
+   -- as a dense LxHxW map
+   function Stream:labels(first, last)
+      first = first or self:retired()+1
+      last = last or self:length()
+      local segm = torch[Real .. 'Tensor']()
+      self:_labels(segm, first-1, last-first+1)
+      return segm
+   end
+
+   -- same, run-length encoded (see videograph.RLE)
+   function Stream:runs(first, last)
+      first = first or self:retired()+1
+      last = last or self:length()
+      local _, height, width = self:size()
+      local rle = videograph.RLE(last-first+1, height, width)
+      self:_runs(rle.rows, rle.runs, first-1, last-first+1)
+      return rle
+   end
+end
+
 ----------------------------------------------------------------------
 -- test me functions
 --
@@ -437,6 +785,63 @@ function videograph.testme_simple(path)
    print '<videograph> done.'
 end
 
+function videograph.testme_rawvideo(path, format, width, height)
+   if not path then
+      print('please provide path to uncompressed video file: testme_rawvideo("path/to/video.y4m")')
+      return
+   end
+   print '<videograph> mapping video'
+   video = videograph.RawVideo{path=path, format=format, width=width, height=height}
+   print('<videograph> ' .. video:size() .. ' frames, processed 10 at a time')
+   for first,last,frames in video:chunks(10) do
+      -- frames is a ByteTensor view into the file: no copy is made
+      local graph = videograph.graph(frames)
+      local segm,n = videograph.segmentmst(graph,5,200)
+      print('<videograph> frames ' .. first .. '-' .. last .. ': ' .. n .. ' components')
+   end
+   print '<videograph> done.'
+end
+
+function videograph.testme_pipeline(path, format, width, height)
+   if not path then
+      print('please provide path to uncompressed video file: testme_pipeline("path/to/video.y4m")')
+      return
+   end
+   video = videograph.RawVideo{path=path, format=format, width=width, height=height}
+   local pipeline = videograph.Pipeline{thres=5, minsize=200}
+   local function collect()
+      local segm,n,stats,pairs,index = pipeline:result()
+      print('<videograph> chunk ' .. index .. ': ' .. n .. ' components')
+   end
+   for first,last,frames in video:chunks(10) do
+      if pipeline:submit(frames) > 3 then collect() end
+   end
+   while pipeline:pending() > 0 do collect() end
+   print '<videograph> done.'
+end
+
+function videograph.testme_stream(path, format, width, height)
+   if not path then
+      print('please provide path to uncompressed video file: testme_stream("path/to/video.y4m")')
+      return
+   end
+   video = videograph.RawVideo{path=path, format=format, width=width, height=height}
+   local stream = videograph.Stream{thres=5, minsize=200}
+   -- chunks share one frame: the temporal edges to the previous chunk;
+   -- only a window of the last 30 frames is kept, so that memory stays
+   -- bounded however long the video (component ids carry on)
+   local window = 30
+   for first,last,frames in video:chunks(10, 1) do
+      local n = stream:append(frames, 1)
+      local segm = stream:labels(first, last)
+      local old = stream:length() - stream:retired() - window
+      if old > 0 then stream:retire(old) end
+      print('<videograph> frames ' .. first .. '-' .. last .. ': ' .. n .. ' components ('
+            .. stream:retired() .. ' frames retired)')
+   end
+   print '<videograph> done.'
+end
+
 function videograph.testme_flow(path)
    if not path then
       print('please provide path to video file: testme("path/to/video")')
@@ -0,0 +1,226 @@
+----------------------------------------------------------------------
+--
+-- Copyright (c) 2012 Clement Farabet
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 2 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+--
+----------------------------------------------------------------------
+-- description:
+--     RawVideo - a memory-mapped reader for uncompressed videos
+--                (Y4M, raw planar YUV, raw packed RGB, raw gray).
+--
+--     The file is mapped once; frames are exposed as ByteTensor
+--     views into the mapping (no decoding, no copy), which can be
+--     passed directly to videograph.graph().
+----------------------------------------------------------------------
+
+local RawVideo = torch.class('videograph.RawVideo')
+
+-- chroma layouts: width/height divisors of the two chroma planes
+local chromas = {
+   ['420'] = {2,2}, ['420jpeg'] = {2,2}, ['420paldv'] = {2,2}, ['420mpeg2'] = {2,2},
+   ['422'] = {2,1}, ['444'] = {1,1}, ['mono'] = false
+}
+
+-- raw formats: name -> chroma layout ('rgb' is packed/interleaved)
+local rawformats = {
+   yuv420p = '420', yuv422p = '422', yuv444p = '444', gray = 'mono', rgb = 'rgb'
+}
+
+-- y4m frame marker ('FRAME\n'), as bytes
+local y4mmarker = {70, 82, 65, 77, 69, 10}
+
+-- checks that each of frames [first,last] starts with a plain frame
+-- marker (y4m only): frame parameters, or a corrupt file, would
+-- misalign the views of all the following frames
+local function checkmarkers(self, first, last, caller)
+   if self.marker == 0 then return end
+   for f = first,last do
+      local offset = self.header + (f-1)*self.framestride
+      for i = 1,self.marker do
+         if self.storage[offset+i] ~= y4mmarker[i] then
+            xlua.error('frame ' .. f .. ': frame parameters are not supported '
+                       .. '(or the file is corrupt)', caller)
+         end
+      end
+   end
+end
+
+function RawVideo:__init(...)
+   local args, path, format, width, height = xlua.unpack(
+      {...},
+      'videograph.RawVideo',
+      'memory-map an uncompressed video file, and expose its frames as\n'
+         .. 'ByteTensor views (LxKxHxW or LxHxW) into the mapping',
+      {arg='path', type='string', help='path to video file', req=true},
+      {arg='format', type='string', help='file format: y4m | yuv420p | yuv422p | yuv444p | gray | rgb',
+       default='y4m'},
+      {arg='width', type='number', help='frame width (raw formats only)'},
+      {arg='height', type='number', help='frame height (raw formats only)'}
+   )
+
+   -- parse header
+   local header = 0
+   local chroma
+   if format == 'y4m' then
+      local f = io.open(path, 'rb')
+      if not f then xlua.error('could not open ' .. path, 'videograph.RawVideo') end
+      local line = f:read('*l')
+      f:close()
+      if not line or not line:find('^YUV4MPEG2 ') then
+         xlua.error('not a YUV4MPEG2 file: ' .. path, 'videograph.RawVideo')
+      end
+      chroma = '420'
+      for tag in line:gmatch('%S+') do
+         local t,v = tag:sub(1,1), tag:sub(2)
+         if t == 'W' then width = tonumber(v)
+         elseif t == 'H' then height = tonumber(v)
+         elseif t == 'C' then chroma = v:match('^(%d+%a*)') or v
+         end
+      end
+      if chroma:find('^mono') then chroma = 'mono' end
+      header = #line + 1
+   else
+      chroma = rawformats[format]
+   end
+   if chroma == nil or (chroma ~= 'rgb' and chromas[chroma] == nil) then
+      xlua.error('unsupported format/colorspace: ' .. format .. '/' .. tostring(chroma),
+                 'videograph.RawVideo')
+   end
+   if not width or not height then
+      xlua.error('width and height must be provided for raw formats', 'videograph.RawVideo')
+   end
+
+   -- frame geometry
+   local planesize = width*height
+   local framesize
+   local cw,ch = 0,0
+   if chroma == 'rgb' then
+      framesize = 3*planesize
+   elseif chromas[chroma] then
+      local sub = chromas[chroma]
+      cw = math.ceil(width/sub[1])
+      ch = math.ceil(height/sub[2])
+      framesize = planesize + 2*cw*ch
+   else
+      framesize = planesize
+   end
+
+   -- map file (read-only, private mapping: nothing is loaded upfront)
+   self.storage = torch.ByteStorage(path, false)
+
+   -- y4m frames are each preceded by a 'FRAME\n' marker; frame
+   -- parameters are not supported, so that frames can be indexed (the
+   -- marker of each frame is checked as the frame is read)
+   local marker = 0
+   if format == 'y4m' then marker = #y4mmarker end
+
+   -- store geometry
+   self.path = path
+   self.format = format
+   self.chroma = chroma
+   self.width = width
+   self.height = height
+   self.chroma_width = cw
+   self.chroma_height = ch
+   self.header = header
+   self.marker = marker
+   self.framesize = framesize
+   self.framestride = marker + framesize
+   self.nframes = math.floor((self.storage:size() - header) / self.framestride)
+   if (self.storage:size() - header) % self.framestride ~= 0 then
+      print('<videograph.RawVideo> warning: ' .. path .. ' ends with a partial frame '
+            .. '(truncated file?), which is ignored')
+   end
+   checkmarkers(self, 1, math.min(1, self.nframes), 'videograph.RawVideo')
+end
+
+function RawVideo:size()
+   return self.nframes
+end
+
+-- returns a view on frames [first,last] (1-based, inclusive):
+--   rgb  -> Lx3xHxW (strided, interleaved channels)
+--   444  -> Lx3xHxW (planar Y,U,V)
+--   others -> LxHxW (luma only; see chromaframes())
+function RawVideo:frames(first, last)
+   first = first or 1
+   last = last or self.nframes
+   if first < 1 or last > self.nframes or first > last then
+      xlua.error('frame range [' .. first .. ',' .. last .. '] out of bounds (1..'
+                 .. self.nframes .. ')', 'videograph.RawVideo:frames')
+   end
+   checkmarkers(self, first, last, 'videograph.RawVideo:frames')
+   local length = last - first + 1
+   local offset = 1 + self.header + self.marker + (first-1)*self.framestride
+   local w,h = self.width, self.height
+   if self.chroma == 'rgb' then
+      return torch.ByteTensor(self.storage, offset,
+                              torch.LongStorage{length, 3, h, w},
+                              torch.LongStorage{self.framestride, 1, 3*w, 3})
+   elseif self.chroma == '444' then
+      return torch.ByteTensor(self.storage, offset,
+                              torch.LongStorage{length, 3, h, w},
+                              torch.LongStorage{self.framestride, w*h, w, 1})
+   else
+      return torch.ByteTensor(self.storage, offset,
+                              torch.LongStorage{length, h, w},
+                              torch.LongStorage{self.framestride, w, 1})
+   end
+end
+
+-- returns views on the chroma planes (U,V) of frames [first,last],
+-- each of size LxH'xW' (subsampled, planar formats only)
+function RawVideo:chromaframes(first, last)
+   if self.chroma == 'rgb' or self.chroma == 'mono' then
+      xlua.error('no chroma planes in format ' .. self.format, 'videograph.RawVideo:chromaframes')
+   end
+   first = first or 1
+   last = last or self.nframes
+   if first < 1 or last > self.nframes or first > last then
+      xlua.error('frame range [' .. first .. ',' .. last .. '] out of bounds (1..'
+                 .. self.nframes .. ')', 'videograph.RawVideo:chromaframes')
+   end
+   checkmarkers(self, first, last, 'videograph.RawVideo:chromaframes')
+   local length = last - first + 1
+   local offset = 1 + self.header + self.marker + (first-1)*self.framestride + self.width*self.height
+   local cw,ch = self.chroma_width, self.chroma_height
+   local u = torch.ByteTensor(self.storage, offset,
+                              torch.LongStorage{length, ch, cw},
+                              torch.LongStorage{self.framestride, cw, 1})
+   local v = torch.ByteTensor(self.storage, offset + cw*ch,
+                              torch.LongStorage{length, ch, cw},
+                              torch.LongStorage{self.framestride, cw, 1})
+   return u,v
+end
+
+-- iterates over the video, chunk by chunk: returns first, last, frames;
+-- an overlap of 1 frame lets consecutive chunks share a temporal edge plane
+function RawVideo:chunks(size, overlap)
+   size = size or 10
+   overlap = overlap or 0
+   if overlap >= size then
+      xlua.error('overlap must be smaller than chunk size', 'videograph.RawVideo:chunks')
+   end
+   local first = 1
+   return function()
+      if first > self.nframes then return nil end
+      local last = math.min(first + size - 1, self.nframes)
+      local f = first
+      if last == self.nframes then first = self.nframes + 1
+      else first = last + 1 - overlap end
+      return f, last, self:frames(f, last)
+   end
+end
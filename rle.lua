@@ -0,0 +1,84 @@
+----------------------------------------------------------------------
+--
+-- Copyright (c) 2012 Clement Farabet
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 2 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+--
+----------------------------------------------------------------------
+-- description:
+--     RLE - a run-length encoded segmentation map (LxHxW).
+--
+--     Each of the L*H rows is a sequence of runs along x; a run is
+--     stored as (end, id), end being the (exclusive, 0-based) x at
+--     which it stops:
+--        rows : LongTensor (L*H+1), the runs of row r (1-based) are
+--               runs[{ {rows[r]+1, rows[r+1]} }]
+--        runs : IntTensor (Nx2)
+--     RLE maps are produced by videograph.segmentruns(), or encoded
+--     with videograph.encoderuns(); videograph.extractcomponents(),
+--     colorize() and adjacency() accept them in place of a dense map,
+--     and work run by run. They serialize with torch.save().
+----------------------------------------------------------------------
+
+local RLE = torch.class('videograph.RLE')
+
+function RLE:__init(length, height, width, rows, runs)
+   self.length = length
+   self.height = height
+   self.width = width
+   self.rows = rows or torch.LongTensor()
+   self.runs = runs or torch.IntTensor()
+end
+
+-- dims of the decoded map
+function RLE:size()
+   return self.length, self.height, self.width
+end
+
+-- number of runs
+function RLE:nruns()
+   return self.runs:size(1)
+end
+
+-- decode into a dense LxHxW map
+function RLE:decode(dest)
+   dest = dest or torch.Tensor()
+   dest.videograph.decoderuns(dest, self.rows, self.runs, self.length, self.height, self.width)
+   return dest
+end
+
+----------------------------------------------------------------------
+-- encode a dense segmentation map (LxHxW, integer ids) into runs
+--
+function videograph.encoderuns(segm)
+   if not segm or segm:dim() ~= 3 then
+      print(xlua.usage('videograph.encoderuns',
+                       'run-length encode a segmentation map (along x)',
+                       'segm = videograph.segmentmst(graph)\n'
+                          .. 'rle = videograph.encoderuns(segm)\n'
+                          .. 'segm = rle:decode()',
+                       {type='torch.Tensor', help='input segmentation map (must be LxHxW)', req=true}))
+      xlua.error('incorrect arguments', 'videograph.encoderuns')
+   end
+
+   -- support LongTensors
+   if torch.typename(segm) == 'torch.LongTensor' then
+      segm = torch.Tensor(segm:size(1), segm:size(2), segm:size(3)):copy(segm)
+   end
+
+   local rle = videograph.RLE(segm:size(1), segm:size(2), segm:size(3))
+   segm.videograph.encoderuns(rle.rows, rle.runs, segm)
+   return rle
+end